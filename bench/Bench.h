@@ -0,0 +1,155 @@
+//
+//  Bench.h
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Timing and synthetic market data of the benchmarks.
+//
+
+#ifndef Bench_h
+#define Bench_h
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "StockData.h"
+
+//! Prevents the compiler from dropping the benchmarked calls.
+inline volatile double sSink;
+
+/*!
+ \brief Returns the seconds of one call of the function. Its result is written to sSink.
+ */
+template<typename Function>
+double seconds(Function function)
+{
+   auto begin = std::chrono::steady_clock::now();
+   sSink = function();
+   auto end = std::chrono::steady_clock::now();
+   return std::chrono::duration<double>(end - begin).count();
+}
+
+/*!
+ \brief Calls the function once without timing, then returns the mean seconds of the repetitions.
+ */
+template<typename Function>
+double meanSeconds(int repetitions, Function function)
+{
+   function();
+
+   auto begin = std::chrono::steady_clock::now();
+   for(int repetition = 0; repetition < repetitions; repetition++) sSink = function();
+   auto end = std::chrono::steady_clock::now();
+
+   return std::chrono::duration<double>(end - begin).count() / repetitions;
+}
+
+/*!
+ \brief Prints the mean time of the function, in total and per bar.
+ \return The mean seconds.
+ */
+template<typename Function>
+double measure(const char* name, size_t bars, int repetitions, Function function)
+{
+   double seconds = meanSeconds(repetitions, function);
+   std::printf("%-28s %10.3f ms %8.2f ns/bar\n", name, seconds * 1e3, seconds / bars * 1e9);
+   return seconds;
+}
+
+/*!
+ \brief Generates daily bars as geometric random walk. The same seed gives the same bars.
+ */
+class MarketGenerator
+{
+   public:
+
+      explicit MarketGenerator(uint64 seed): mRandom(seed) {}
+
+      /*!
+       \brief Returns the bars of the trading days (Monday to Friday) ending at lastDay.
+       */
+      std::vector<PriceRecord> generate(size_t bars, int32 lastDay)
+      {
+         std::normal_distribution<double> step(0.0002, 0.015);
+         std::normal_distribution<double> gap(0.0, 0.003);
+         std::exponential_distribution<double> range(200.0);
+         std::lognormal_distribution<double> volume(13.0, 0.6);
+
+         // Walks the days back first, so the series ends at lastDay.
+         std::vector<int32> days(bars);
+         int32 day = lastDay;
+         for(size_t index = bars; index-- > 0;)
+         {
+            while(weekday(day) >= 5) day--;
+            days[index] = day--;
+         }
+
+         std::vector<PriceRecord> records(bars);
+         double close = std::uniform_real_distribution<double>(10.0, 500.0)(mRandom);
+         for(size_t index = 0; index < bars; index++)
+         {
+            double open = close * (1.0 + gap(mRandom));
+            close = open * std::exp(step(mRandom));
+
+            PriceRecord& record = records[index];
+            record.date = daysToDate(days[index]);
+            record.open = open;
+            record.close = close;
+            record.high = std::max(open, close) * (1.0 + range(mRandom));
+            record.low = std::min(open, close) * (1.0 - range(mRandom));
+            record.volume = (int64)volume(mRandom);
+         }
+         return records;
+      }
+
+      /*!
+       \brief Returns minute bars of the regular US sessions (14:30 to 21:00 UTC, Monday to Friday)
+       ending at the close of lastDay.
+       */
+      std::vector<IntradayRecord> generateIntraday(size_t bars, int32 lastDay)
+      {
+         const size_t session = 390;
+         std::vector<PriceRecord> days = generate((bars + session - 1) / session, lastDay);
+         std::normal_distribution<double> step(0.0, 0.0008);
+         std::lognormal_distribution<double> volume(8.0, 1.0);
+
+         std::vector<IntradayRecord> records;
+         records.reserve(days.size() * session);
+         for(const PriceRecord& day : days)
+         {
+            int64 open = dateToDays(day.date) * kSecondsPerDay + (14 * 60 + 30) * 60;
+            double close = day.open;
+            for(size_t minute = 0; minute < session; minute++)
+            {
+               double first = close;
+               close = first * std::exp(step(mRandom));
+               records.push_back({open + (int64)minute * 60,
+                                  first,
+                                  std::max(first, close) * 1.0002,
+                                  std::min(first, close) * 0.9998,
+                                  close,
+                                  (int64)volume(mRandom)});
+            }
+         }
+         records.erase(records.begin(), records.end() - bars);
+         return records;
+      }
+
+   private:
+
+      std::mt19937_64 mRandom;
+
+      //! 0 is Monday, 1970-01-01 was a Thursday.
+      static int32 weekday(int32 day)
+      {
+         return ((day + 3) % 7 + 7) % 7;
+      }
+};
+
+#endif
@@ -0,0 +1,376 @@
+//
+//  ChunkBench.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Benchmark of the compressed price chunks (see PriceChunks.h). Every case is encoded and decoded
+//  in chunks, the decoded bars must match the encoded ones bit for bit. Truncated and corrupt
+//  chunks must be rejected, and a compressed database must return the same bars and pages as the
+//  rows it was converted from.
+//
+//  Usage: chunk_bench [bars] [repetitions] [database]
+//
+//    bars         Bars per case (100000)
+//    database     Temporary database, deleted before and after the run (chunk_bench.db)
+//
+
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "StockData.h"
+#include "PriceChunks.h"
+#include "Bench.h"
+
+/*!
+ \brief Returns the number of bars, which differ between the histories. Prices are compared bit
+ for bit, so NaN and -0.0 must be restored exactly.
+ */
+static size_t mismatches(const PriceHistory& expected, const PriceHistory& actual)
+{
+   auto same = [](double a, double b)
+   {
+      return std::bit_cast<uint64>(a) == std::bit_cast<uint64>(b);
+   };
+
+   size_t size = std::min(expected.size(), actual.size());
+   size_t count = std::max(expected.size(), actual.size()) - size;
+   for(size_t index = 0; index < size; index++)
+   {
+      if(expected.time(index) != actual.time(index)
+         || expected.days()[index] != actual.days()[index]
+         || !same(expected.opens()[index], actual.opens()[index])
+         || !same(expected.highs()[index], actual.highs()[index])
+         || !same(expected.lows()[index], actual.lows()[index])
+         || !same(expected.closes()[index], actual.closes()[index])
+         || expected.volumes()[index] != actual.volumes()[index])
+      {
+         count++;
+      }
+   }
+   return count;
+}
+
+/*!
+ \brief Encodes the history in chunks and decodes them again.
+ \return The number of mismatching bars.
+ */
+static size_t roundTrip(const char* name, const PriceHistory& history, int repetitions)
+{
+   std::vector<std::vector<uint8>> encoded;
+   size_t bytes = 0;
+   for(size_t first = 0; first < history.size(); first += chunks::kChunkSize)
+   {
+      encoded.emplace_back();
+      chunks::encode(history,
+                     first,
+                     std::min(chunks::kChunkSize, history.size() - first),
+                     encoded.back());
+      bytes += encoded.back().size();
+   }
+
+   PriceHistory decoded(history.interval());
+   size_t failed = 0;
+   for(const std::vector<uint8>& chunk : encoded)
+   {
+      if(!chunks::decode(chunk.data(), chunk.size(), decoded)) failed++;
+   }
+   size_t count = mismatches(history, decoded);
+
+   std::printf("%-28s %8.2f bytes/bar, %zu mismatches, %zu chunks rejected\n",
+               name,
+               (double)bytes / history.size(),
+               count,
+               failed);
+
+   std::vector<uint8> buffer;
+   measure("  encode", history.size(), repetitions, [&]()
+   {
+      size_t size = 0;
+      for(size_t first = 0; first < history.size(); first += chunks::kChunkSize)
+      {
+         chunks::encode(history,
+                        first,
+                        std::min(chunks::kChunkSize, history.size() - first),
+                        buffer);
+         size += buffer.size();
+      }
+      return (double)size;
+   });
+
+   measure("  decode", history.size(), repetitions, [&]()
+   {
+      PriceHistory result(history.interval());
+      result.reserve(history.size());
+      for(const std::vector<uint8>& chunk : encoded)
+      {
+         chunks::decode(chunk.data(), chunk.size(), result);
+      }
+      return result.closes().back();
+   });
+
+   return count + failed;
+}
+
+/*!
+ \brief Returns the number of damaged versions of the chunk, which are decoded without error or
+ change the history.
+ */
+static size_t corruptChunks(const std::vector<uint8>& chunk)
+{
+   size_t accepted = 0;
+   auto check = [&](const std::vector<uint8>& data)
+   {
+      PriceHistory history;
+      if(chunks::decode(data.data(), data.size(), history) || history.size() != 0) accepted++;
+   };
+
+   // Every truncation.
+   for(size_t size = 0; size < chunk.size(); size++)
+   {
+      check(std::vector<uint8>(chunk.begin(), chunk.begin() + size));
+   }
+
+   // Unknown version.
+   std::vector<uint8> damaged = chunk;
+   damaged[0]++;
+   check(damaged);
+
+   // Trailing bytes.
+   damaged = chunk;
+   damaged.push_back(0);
+   check(damaged);
+
+   // More bars than the chunk can hold.
+   damaged = chunk;
+   damaged[1] = 0xff;
+   damaged.insert(damaged.begin() + 2, {0xff, 0xff, 0x0f});
+   check(damaged);
+
+   std::printf("%-28s %zu of %zu accepted\n", "corrupt chunks", accepted, chunk.size() + 3);
+   return accepted;
+}
+
+int main(int argc, const char* argv[])
+{
+   size_t count = std::max<size_t>(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000, 3);
+   int repetitions = std::max(argc > 2 ? std::atoi(argv[2]) : 10, 1);
+   const char* dbFile = argc > 3 ? argv[3] : "chunk_bench.db";
+
+   const int32 lastDay = daysFromCivil(2026, 10, 16);
+   MarketGenerator generator(42);
+   std::mt19937_64 random(42);
+   auto cents = [](double price)
+   {
+      return std::round(price * 100.0) / 100.0;
+   };
+
+   std::printf("%zu bars per case, %d repetitions\n\n", count, repetitions);
+   size_t failures = 0;
+
+   // Daily bars with the prices in cents as quoted. The prices take the decimal encoding. The walk
+   // restarts every 5000 bars (20 years), so the prices stay in the range of quoted ones.
+   std::vector<PriceRecord> dailyRecords;
+   for(int32 last = daysFromCivil(1900, 1, 1); dailyRecords.size() < count;)
+   {
+      const size_t segment = 5000;
+      last += segment * 7 / 5 + 7;
+      std::vector<PriceRecord> records =
+         generator.generate(std::min(segment, count - dailyRecords.size()), last);
+      dailyRecords.insert(dailyRecords.end(), records.begin(), records.end());
+   }
+   PriceHistory precise;
+   PriceHistory daily;
+   for(PriceRecord& record : dailyRecords)
+   {
+      precise.append(record);
+      record.open = cents(record.open);
+      record.high = cents(record.high);
+      record.low = cents(record.low);
+      record.close = cents(record.close);
+      daily.append(record);
+   }
+   failures += roundTrip("daily, cents", daily, repetitions);
+
+   // The same walk at full precision, the prices take the XOR encoding.
+   failures += roundTrip("daily, full precision", precise, repetitions);
+
+   // Minute bars of the regular sessions, with gaps over nights and weekends.
+   std::vector<IntradayRecord> minuteRecords = generator.generateIntraday(count, lastDay);
+   PriceHistory minutes(BarInterval::kMinute);
+   for(IntradayRecord& record : minuteRecords)
+   {
+      record.open = cents(record.open);
+      record.high = cents(record.high);
+      record.low = cents(record.low);
+      record.close = cents(record.close);
+      minutes.append(record);
+   }
+   failures += roundTrip("minutes, cents", minutes, repetitions);
+
+   // Random gaps up to 2^40 seconds, also before 1970, need the 64-bit bucket of the times.
+   PriceHistory gaps(BarInterval::kMinute);
+   {
+      int64 time = -(int64(1) << 41);
+      std::uniform_int_distribution<int> exponent(0, 40);
+      for(size_t index = 0; index < count; index++)
+      {
+         time += 60 + (int64)(random() & ((uint64(1) << exponent(random)) - 1));
+         gaps.appendIntraday(time, 1.5, 2.25, 1.0, 2.0, (int64)index);
+      }
+   }
+   failures += roundTrip("large time gaps", gaps, repetitions);
+
+   // Random bit patterns, mostly NaN and huge values. Their XORs have more than 56 meaningful bits.
+   PriceHistory patterns;
+   for(size_t index = 0; index < count; index++)
+   {
+      patterns.append((int32)(index * 7),
+                      std::bit_cast<double>(random()),
+                      std::bit_cast<double>(random()),
+                      std::bit_cast<double>(random()),
+                      std::bit_cast<double>(random()),
+                      (int64)random());
+   }
+   failures += roundTrip("random bit patterns", patterns, repetitions);
+
+   // Special values, which must fall back from the decimal encoding.
+   PriceHistory special;
+   {
+      const double values[] = {0.0,
+                               -0.0,
+                               1.25,
+                               std::numeric_limits<double>::quiet_NaN(),
+                               -std::numeric_limits<double>::infinity(),
+                               std::numeric_limits<double>::infinity(),
+                               std::numeric_limits<double>::denorm_min(),
+                               std::numeric_limits<double>::max(),
+                               1e15,
+                               -12.3456};
+      const int64 volumes[] = {0,
+                               -1,
+                               std::numeric_limits<int64>::min(),
+                               std::numeric_limits<int64>::max()};
+      size_t size = std::size(values);
+      for(size_t index = 0; index < count; index++)
+      {
+         special.append((int32)index,
+                        values[index % size],
+                        values[(index / size) % size],
+                        values[(index * 3) % size],
+                        values[(index / 7) % size],
+                        volumes[index % std::size(volumes)]);
+      }
+   }
+   failures += roundTrip("NaN, -0.0 and infinity", special, repetitions);
+
+   // A single bar and two bars have no or only the first delta.
+   for(size_t size = 1; size <= 2; size++)
+   {
+      PriceHistory shortHistory;
+      shortHistory.append(daily, 0, size);
+      failures += roundTrip(size == 1 ? "one bar" : "two bars", shortHistory, 1);
+   }
+
+   std::vector<uint8> chunk;
+   chunks::encode(daily, 0, std::min(count, size_t(200)), chunk);
+   failures += corruptChunks(chunk);
+
+   //
+   // Database: rows and the chunks converted from them must return the same bars.
+   //
+   std::remove(dbFile);
+   {
+      StockDatabase db(dbFile);
+      if(!db.initSchema()) return 1;
+      db.addStock("DAILY", "Daily", "USD");
+      db.addStock("MINUTE", "Minute", "USD");
+      db.insertPrices("DAILY", dailyRecords);
+      db.insertIntradayPrices("MINUTE", BarInterval::kMinute, minuteRecords);
+
+      // Chunk borders and partial chunks.
+      const size_t counts[] = {1, 250, chunks::kChunkSize - 1, chunks::kChunkSize,
+                               chunks::kChunkSize + 1, 3 * chunks::kChunkSize + 17, count + 1};
+      const size_t positions[] = {0, 1, chunks::kChunkSize, chunks::kChunkSize + 1, count / 2,
+                                  count - 1, count};
+
+      struct Query
+      {
+         bool intraday;
+         size_t position;
+         size_t count;
+         PriceHistory rows;
+      };
+      std::vector<Query> queries;
+      for(size_t position : positions)
+      {
+         position = std::min(position, count);
+         for(size_t bars : counts)
+         {
+            int32 day = position < count ? daily.days()[position] : daily.days().back() + 1;
+            int64 time = position < count ? minutes.times()[position] : minutes.times().back() + 60;
+            queries.push_back({false, position, bars,
+                               db.getPricesBefore("DAILY", daysToDate(day), bars)});
+            queries.push_back({true, position, bars,
+                               db.getIntradayPricesBefore("MINUTE", BarInterval::kMinute, time,
+                                                          bars)});
+         }
+      }
+
+      PriceHistory rows;
+      measure("db.load rows", count, repetitions, [&]()
+      {
+         rows = std::unique_ptr<Stock>(db.stock("DAILY"))->priceHistory;
+         return rows.closes().back();
+      });
+
+      if(!db.compressPrices()) return 1;
+
+      PriceHistory compressed;
+      measure("db.load chunks", count, repetitions, [&]()
+      {
+         compressed = std::unique_ptr<Stock>(db.stock("DAILY"))->priceHistory;
+         return compressed.closes().back();
+      });
+
+      size_t mismatching = mismatches(rows, compressed);
+      for(const Query& query : queries)
+      {
+         size_t position = query.position;
+         PriceHistory chunked =
+            query.intraday
+               ? db.getIntradayPricesBefore("MINUTE",
+                                            BarInterval::kMinute,
+                                            position < count ? minutes.times()[position]
+                                                             : minutes.times().back() + 60,
+                                            query.count)
+               : db.getPricesBefore("DAILY",
+                                    daysToDate(position < count ? daily.days()[position]
+                                                                : daily.days().back() + 1),
+                                    query.count);
+         mismatching += mismatches(query.rows, chunked);
+      }
+
+      // Paging through the chunks gives the complete history.
+      std::unique_ptr<Stock> paged(db.stock("MINUTE", BarInterval::kMinute, 250));
+      while(paged->hasOlder()) paged->loadOlder(3 * chunks::kChunkSize / 2);
+      mismatching += mismatches(minutes, paged->priceHistory);
+
+      std::printf("%-28s %zu mismatches in %zu queries\n",
+                  "database",
+                  mismatching,
+                  queries.size() + 2);
+      failures += mismatching;
+   }
+   std::remove(dbFile);
+
+   std::printf("\nmismatches: %zu\n", failures);
+   return failures == 0 ? 0 : 1;
+}
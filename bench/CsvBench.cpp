@@ -0,0 +1,115 @@
+//
+//  CsvBench.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Benchmark of the streaming price CSV parser.
+//
+//  Usage: csv_bench [file ...]
+//
+//  Without files, a fixture with 2 million rows in Alpha Vantage format is generated in the
+//  temporary directory. The files are read into memory first and fed to the parser in chunks of
+//  16 KiB (the write buffer size of curl), so only parsing is measured.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PriceCsvParser.h"
+
+static const size_t kChunkSize = 16 * 1024;
+
+static std::string generateFixture(size_t rows)
+{
+   std::string path = "/tmp/csv_bench_fixture.csv";
+   FILE* file = std::fopen(path.c_str(), "wb");
+   if(file == nullptr) return std::string();
+
+   std::fprintf(file, "timestamp,open,high,low,close,volume\r\n");
+
+   std::mt19937_64 random(42);
+   std::normal_distribution<double> step(0.0, 1.0);
+   double price = 100.0;
+   const int32 newest = daysFromCivil(2025, 9, 1);
+   const int32 oldest = daysFromCivil(1900, 1, 1);
+   int32 day = newest;
+
+   // Newest first, like the API. Dates repeat for very large fixtures, which is fine for parsing.
+   for(size_t row = 0; row < rows; row++, day--)
+   {
+      if(day < oldest) day = newest;
+      jm::Date date = daysToDate(day);
+      double open = price;
+      price = std::max(1.0, price + step(random));
+      double high = std::max(open, price) + std::abs(step(random));
+      double low = std::min(open, price) - std::abs(step(random));
+      std::fprintf(file, "%04d-%02d-%02d,%.4f,%.4f,%.4f,%.4f,%lld\r\n",
+                   date.year(), date.month() + 1, date.date(),
+                   open, high, std::max(low, 0.01), price,
+                   (long long)(random() % 100000000));
+   }
+
+   std::fclose(file);
+   return path;
+}
+
+static bool readFile(const std::string& path, std::vector<char>& content)
+{
+   FILE* file = std::fopen(path.c_str(), "rb");
+   if(file == nullptr) return false;
+
+   std::fseek(file, 0, SEEK_END);
+   content.resize(std::ftell(file));
+   std::fseek(file, 0, SEEK_SET);
+   bool success = std::fread(content.data(), 1, content.size(), file) == content.size();
+   std::fclose(file);
+   return success;
+}
+
+int main(int argc, const char* argv[])
+{
+   std::vector<std::string> files;
+   for(int index = 1; index < argc; index++) files.push_back(argv[index]);
+   if(files.empty()) files.push_back(generateFixture(2000000));
+
+   for(const std::string& path : files)
+   {
+      std::vector<char> content;
+      if(!readFile(path, content))
+      {
+         std::fprintf(stderr, "Can't read %s\n", path.c_str());
+         return 1;
+      }
+
+      double checksum = 0.0;
+      size_t batches = 0;
+      PriceCsvParser parser([&](std::span<const PriceRecord> records)
+      {
+         for(const PriceRecord& record : records) checksum += record.close;
+         batches++;
+         return true;
+      });
+
+      auto begin = std::chrono::steady_clock::now();
+      for(size_t offset = 0; offset < content.size(); offset += kChunkSize)
+      {
+         parser.feed(content.data() + offset, std::min(kChunkSize, content.size() - offset));
+      }
+      parser.finish();
+      auto end = std::chrono::steady_clock::now();
+
+      double seconds = std::chrono::duration<double>(end - begin).count();
+      std::printf("%s\n", path.c_str());
+      std::printf("  %zu rows, %zu errors, %zu batches, checksum %.4f\n",
+                  parser.rows(), parser.errors(), batches, checksum);
+      std::printf("  %.3f s, %.1f MB/s, %.2f M rows/s\n",
+                  seconds, content.size() / seconds * 1e-6, parser.rows() / seconds * 1e-6);
+   }
+
+   return 0;
+}
@@ -0,0 +1,112 @@
+//
+//  KernelBench.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Micro benchmark of the reduction kernels against the former scalar loops of Stock.
+//
+//  Usage: kernel_bench [values] [repetitions]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Kernels.h"
+#include "Bench.h"
+
+// The scalar loops as they were used in Stock::minPrice, maxPrice and maxVolume.
+
+static double scalarMin(const std::vector<double>& values)
+{
+   double price = values[0];
+   for(size_t index = 1; index < values.size(); index++)
+   {
+      double low = values[index];
+      if(low < price) price = low;
+   }
+   return price;
+}
+
+static double scalarMax(const std::vector<double>& values)
+{
+   double price = values[0];
+   for(size_t index = 1; index < values.size(); index++)
+   {
+      double high = values[index];
+      if(high > price) price = high;
+   }
+   return price;
+}
+
+static int64 scalarMaxVolume(const std::vector<int64>& values)
+{
+   int64 volume = values[0];
+   for(size_t index = 1; index < values.size(); index++)
+   {
+      int64 vol = values[index];
+      if(vol > volume) volume = vol;
+   }
+   return volume;
+}
+
+/*!
+ \brief Prints the mean time of the function and the values per second.
+ */
+template<typename Function>
+static void throughput(const char* name, size_t values, int repetitions, Function function)
+{
+   double seconds = meanSeconds(repetitions, function);
+   std::printf("%-28s %10.3f us %10.2f Gvalues/s\n", name, seconds * 1e6, values / seconds * 1e-9);
+}
+
+int main(int argc, const char* argv[])
+{
+   size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+   int repetitions = argc > 2 ? std::atoi(argv[2]) : 200;
+
+   // Random walk
+   std::mt19937_64 random(42);
+   std::normal_distribution<double> step(0.0, 1.0);
+   std::vector<double> highs(count), lows(count), closes(count);
+   std::vector<int64> volumes(count);
+   double price = 100.0;
+   for(size_t index = 0; index < count; index++)
+   {
+      price = std::max(1.0, price + step(random));
+      closes[index] = price;
+      highs[index] = price + std::abs(step(random));
+      lows[index] = price - std::abs(step(random));
+      volumes[index] = (int64)(random() % 100000000);
+   }
+
+   std::printf("%zu values, %d repetitions, best supported: %s\n\n",
+               count, repetitions, kernels::isaName(kernels::supportedIsa()));
+
+   std::printf("[former scalar loops]\n");
+   throughput("minPrice", count, repetitions, [&]() { return scalarMin(lows); });
+   throughput("maxPrice", count, repetitions, [&]() { return scalarMax(highs); });
+   throughput("maxVolume", count, repetitions, [&]() { return (double)scalarMaxVolume(volumes); });
+
+   for(kernels::Isa isa : {kernels::Isa::kScalar, kernels::Isa::kSSE2, kernels::Isa::kAVX2})
+   {
+      if(kernels::selectIsa(isa) != isa) continue;
+
+      std::printf("\n[kernels: %s]\n", kernels::isaName(isa));
+      throughput("minimum", count, repetitions, [&]() { return kernels::minimum(lows.data(), count); });
+      throughput("maximum", count, repetitions, [&]() { return kernels::maximum(highs.data(), count); });
+      throughput("maximum (volume)", count, repetitions, [&]() { return (double)kernels::maximum(volumes.data(), count); });
+      throughput("sum", count, repetitions, [&]() { return kernels::sum(closes.data(), count); });
+      throughput("mean", count, repetitions, [&]() { return kernels::mean(closes.data(), count); });
+      throughput("variance", count, repetitions, [&]() { return kernels::variance(closes.data(), count); });
+      throughput("meanTrueRange", count, repetitions, [&]()
+      {
+         return kernels::meanTrueRange(highs.data(), lows.data(), closes.data(), count);
+      });
+   }
+
+   return 0;
+}
@@ -0,0 +1,139 @@
+//
+//  PipelineBench.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Benchmark of the fused MACD pipeline against the former MACD class of MainWindow.cpp and the
+//  streaming indicators::Macd.
+//
+//  Usage: pipeline_bench [bars] [repetitions]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "StockData.h"
+#include "Pipeline.h"
+#include "Bench.h"
+
+// The MACD class as it was used before the indicator engine: the closes are copied, each EMA is a
+// separate pass with its own result vector.
+
+struct MACDPoint
+{
+   double macd;
+   double signal;
+   double histogram;
+};
+
+static std::vector<double> formerEMA(const std::vector<double>& data, int period)
+{
+   std::vector<double> ema;
+   if(data.size() < (size_t)period) return ema;
+
+   double sum = 0.0;
+   for(int i = 0; i < period; ++i) sum += data[i];
+   double prevEma = sum / period;
+   ema.push_back(prevEma);
+
+   double multiplier = 2.0 / (period + 1);
+   for(size_t i = period; i < data.size(); ++i)
+   {
+      double currentEma = (data[i] - prevEma) * multiplier + prevEma;
+      ema.push_back(currentEma);
+      prevEma = currentEma;
+   }
+   return ema;
+}
+
+static std::vector<MACDPoint> formerMACD(const PriceHistory& prices)
+{
+   const int shortPeriod = 12;
+   const int longPeriod = 26;
+   const int signalPeriod = 9;
+
+   std::vector<double> closes;
+   for(size_t i = 0; i < prices.size(); ++i) closes.push_back(prices.closes()[i]);
+
+   std::vector<double> emaShort = formerEMA(closes, shortPeriod);
+   std::vector<double> emaLong = formerEMA(closes, longPeriod);
+
+   std::vector<double> macdLine;
+   size_t minSize = std::min(emaShort.size(), emaLong.size());
+   for(size_t i = 0; i < minSize; ++i)
+   {
+      macdLine.push_back(emaShort[i + (longPeriod - shortPeriod)] - emaLong[i]);
+   }
+
+   std::vector<double> signalLine = formerEMA(macdLine, signalPeriod);
+   std::vector<MACDPoint> result;
+
+   size_t signalOffset = macdLine.size() - signalLine.size();
+   for(size_t i = 0; i < signalLine.size(); ++i)
+   {
+      double macd = macdLine[i + signalOffset];
+      double signal = signalLine[i];
+      result.push_back({macd, signal, macd - signal});
+   }
+   return result;
+}
+
+int main(int argc, const char* argv[])
+{
+   size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+   int repetitions = argc > 2 ? std::atoi(argv[2]) : 10;
+
+   PriceHistory history;
+   history.reserve(count);
+   MarketGenerator generator(42);
+   for(const PriceRecord& record : generator.generate(count, daysFromCivil(2026, 10, 16)))
+   {
+      history.append(record);
+   }
+
+   std::vector<double> macdLine(count), signalLine(count), histogram(count);
+
+   std::printf("%zu bars, %d repetitions\n\n", count, repetitions);
+
+   double former = measure("former MACD class", count, repetitions, [&]()
+   {
+      return formerMACD(history).back().histogram;
+   });
+
+   double streaming = measure("indicators::Macd", count, repetitions, [&]()
+   {
+      indicators::Macd macd;
+      macd.compute(history.closes(), macdLine, signalLine, histogram);
+      return histogram.back();
+   });
+
+   double fused = measure("pipeline::macd", count, repetitions, [&]()
+   {
+      pipeline::MacdPipeline macd = pipeline::macd();
+      macd.run<3, 4, 5>(history, macdLine, signalLine, histogram);
+      return histogram.back();
+   });
+
+   std::printf("\nspeedup fused vs. former: %.2fx, vs. streaming: %.2fx\n",
+               former / fused, streaming / fused);
+
+   // The fused pipeline must produce exactly the values of the former class.
+   std::vector<MACDPoint> expected = formerMACD(history);
+   size_t offset = count - expected.size();
+   size_t mismatches = 0;
+   for(size_t index = 0; index < expected.size(); index++)
+   {
+      if(expected[index].macd != macdLine[offset + index]
+         || expected[index].signal != signalLine[offset + index]
+         || expected[index].histogram != histogram[offset + index])
+      {
+         mismatches++;
+      }
+   }
+   std::printf("mismatches: %zu\n", mismatches);
+
+   return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,357 @@
+//
+//  StocksBench.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Benchmark suite of the hot paths on synthetic market data. The results are written as JSON, so
+//  they can be compared between releases on the same hardware.
+//
+//  Usage: stocks_bench [--symbols N] [--bars N] [--minutes N] [--series N] [--seed N]
+//                      [--repetitions N] [--compress 0|1] [--db FILE] [--output FILE]
+//
+//    --symbols, --bars  Stocks and bars per stock of the database benchmarks (2000 x 1000)
+//    --minutes          Minute bars of the intraday database benchmarks (1000000)
+//    --series           Bars of the long series of the range, MACD and chart benchmarks (2000000)
+//    --compress         1 stores the prices of the database benchmarks in compressed chunks (0)
+//    --db               Temporary database, deleted before and after the run (stocks_bench.db)
+//    --output           Report file, the standard output if not set
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Stocks.h"
+#include "Bench.h"
+
+/*!
+ \brief Result of a benchmark.
+ */
+struct Result
+{
+   std::string name;
+
+   //! Number of items (rows, bars, queries, frames) of one repetition.
+   size_t items;
+
+   const char* unit;
+
+   int repetitions;
+
+   //! Fastest and median repetition in seconds.
+   double best;
+   double median;
+};
+
+/*!
+ \brief Runs the function repetitions times, prepare is called before each run and not timed.
+ */
+template<typename Prepare, typename Function>
+static Result measure(const char* name,
+                      size_t items,
+                      const char* unit,
+                      int repetitions,
+                      Prepare prepare,
+                      Function function)
+{
+   std::vector<double> times;
+   for(int repetition = 0; repetition < repetitions; repetition++)
+   {
+      prepare();
+      times.push_back(seconds(function));
+   }
+   std::sort(times.begin(), times.end());
+
+   Result result = {name, items, unit, repetitions, times.front(), times[times.size() / 2]};
+   std::fprintf(stderr,
+                "%-24s %12.3f ms %14.1f ns/%s\n",
+                name,
+                result.best * 1e3,
+                result.best / items * 1e9,
+                unit);
+   return result;
+}
+
+template<typename Function>
+static Result measure(const char* name,
+                      size_t items,
+                      const char* unit,
+                      int repetitions,
+                      Function function)
+{
+   return measure(name, items, unit, repetitions, [] {}, function);
+}
+
+static bool writeReport(const char* path,
+                        const std::vector<Result>& results,
+                        const std::vector<std::pair<const char*, uint64>>& settings)
+{
+   std::FILE* file = path != nullptr ? std::fopen(path, "wb") : stdout;
+   if(file == nullptr)
+   {
+      std::fprintf(stderr, "Cannot write %s\n", path);
+      return false;
+   }
+
+   std::fprintf(file, "{\n  \"benchmark\": \"stocks\",\n  \"settings\": {");
+   for(size_t index = 0; index < settings.size(); index++)
+   {
+      std::fprintf(file,
+                   "%s\n    \"%s\": %llu",
+                   index > 0 ? "," : "",
+                   settings[index].first,
+                   (unsigned long long)settings[index].second);
+   }
+   std::fprintf(file, "\n  },\n  \"results\": [");
+   for(size_t index = 0; index < results.size(); index++)
+   {
+      const Result& result = results[index];
+      std::fprintf(file,
+                   "%s\n    {\"name\": \"%s\", \"items\": %zu, \"unit\": \"%s\", "
+                   "\"repetitions\": %d, \"bestSeconds\": %.9g, \"medianSeconds\": %.9g, "
+                   "\"nsPerItem\": %.6g, \"itemsPerSecond\": %.6g}",
+                   index > 0 ? "," : "",
+                   result.name.c_str(),
+                   result.items,
+                   result.unit,
+                   result.repetitions,
+                   result.best,
+                   result.median,
+                   result.best / result.items * 1e9,
+                   result.items / result.best);
+   }
+   std::fprintf(file, "\n  ]\n}\n");
+
+   bool success = std::ferror(file) == 0;
+   if(file != stdout && std::fclose(file) != 0) success = false;
+   return success;
+}
+
+static uint64 option(int argc, const char* argv[], const char* name, uint64 fallback)
+{
+   for(int index = 1; index + 1 < argc; index++)
+   {
+      if(std::strcmp(argv[index], name) == 0) return std::strtoull(argv[index + 1], nullptr, 10);
+   }
+   return fallback;
+}
+
+static const char* textOption(int argc, const char* argv[], const char* name, const char* fallback)
+{
+   for(int index = 1; index + 1 < argc; index++)
+   {
+      if(std::strcmp(argv[index], name) == 0) return argv[index + 1];
+   }
+   return fallback;
+}
+
+int main(int argc, const char* argv[])
+{
+   size_t symbols = option(argc, argv, "--symbols", 2000);
+   size_t bars = option(argc, argv, "--bars", 1000);
+   size_t minutes = std::max<size_t>(option(argc, argv, "--minutes", 1000000), 1);
+   size_t series = option(argc, argv, "--series", 2000000);
+   uint64 seed = option(argc, argv, "--seed", 42);
+   int repetitions = std::max((int)option(argc, argv, "--repetitions", 5), 1);
+   bool compress = option(argc, argv, "--compress", 0) != 0;
+   const char* dbFile = textOption(argc, argv, "--db", "stocks_bench.db");
+   const char* output = textOption(argc, argv, "--output", nullptr);
+
+   const int32 lastDay = daysFromCivil(2026, 10, 16);
+   std::vector<Result> results;
+
+   //
+   // Database
+   //
+   {
+      std::remove(dbFile);
+      DatabaseOptions options;
+      options.compressPrices = compress;
+      StockDatabase db(dbFile, options);
+      if(!db.initSchema()) return 1;
+
+      MarketGenerator generator(seed);
+      std::vector<std::vector<PriceRecord>> stocks(symbols);
+      std::vector<jm::String> names(symbols);
+      for(size_t index = 0; index < symbols; index++)
+      {
+         char name[24];
+         std::snprintf(name, sizeof(name), "S%05zu", index);
+         names[index] = jm::String(name);
+         stocks[index] = generator.generate(bars, lastDay);
+         db.addStock(names[index], names[index], "USD");
+      }
+
+      // Replaces the same rows in later repetitions, which costs the same as the first insert.
+      results.push_back(measure("db.insert", symbols * bars, "row", repetitions, [&]
+      {
+         bool success = true;
+         for(size_t index = 0; index < symbols; index++)
+         {
+            success = db.insertPrices(names[index], stocks[index]) && success;
+         }
+         return success ? 1.0 : 0.0;
+      }));
+
+      results.push_back(measure("db.load", symbols * bars, "row", repetitions, [&]
+      {
+         double sum = 0.0;
+         for(size_t index = 0; index < symbols; index++)
+         {
+            std::unique_ptr<Stock> stock(db.stock(names[index]));
+            sum += stock->priceHistory.closes().back();
+         }
+         return sum;
+      }));
+
+      const size_t pageBars = std::min<size_t>(TradingChart::kPageSize, bars);
+      results.push_back(measure("db.loadPage", symbols * pageBars, "row", repetitions, [&]
+      {
+         double sum = 0.0;
+         for(size_t index = 0; index < symbols; index++)
+         {
+            std::unique_ptr<Stock> stock(db.stock(names[index], pageBars));
+            sum += stock->priceHistory.closes().back();
+         }
+         return sum;
+      }));
+
+      // One symbol with a long minute history.
+      std::vector<IntradayRecord> intraday = generator.generateIntraday(minutes, lastDay);
+      results.push_back(measure("db.insertIntraday", minutes, "row", repetitions, [&]
+      {
+         return db.insertIntradayPrices(names[0], BarInterval::kMinute, intraday) ? 1.0 : 0.0;
+      }));
+
+      results.push_back(measure("db.loadIntraday", minutes, "row", repetitions, [&]
+      {
+         std::unique_ptr<Stock> stock(db.stock(names[0], BarInterval::kMinute));
+         return stock->priceHistory.closes().back();
+      }));
+   }
+
+   // Closed, so the write-ahead log is checkpointed into the file.
+   std::error_code error;
+   std::fprintf(stderr,
+                "%-24s %12llu bytes\n",
+                "db.fileSize",
+                (unsigned long long)std::filesystem::file_size(dbFile, error));
+   std::remove(dbFile);
+
+   //
+   // Long series
+   //
+   Stock stock;
+   stock.symbol = "SERIES";
+   stock.name = "Series";
+   MarketGenerator generator(seed + 1);
+   for(const PriceRecord& record : generator.generate(series, lastDay))
+   {
+      stock.priceHistory.append(record);
+   }
+
+   {
+      // Random ranges of all lengths, drawn before the measurement. Each range is one min and one
+      // max query.
+      const size_t queries = 1000000;
+      std::mt19937_64 random(seed);
+      std::vector<std::pair<size_t, size_t>> ranges(queries);
+      for(std::pair<size_t, size_t>& range : ranges)
+      {
+         size_t first = random() % series;
+         size_t last = random() % series;
+         range = {std::min(first, last), std::max(first, last)};
+      }
+
+      sSink = stock.minPrice(0, series - 1);
+      results.push_back(measure("stock.minMax", queries, "range", repetitions, [&]
+      {
+         double sum = 0.0;
+         for(const std::pair<size_t, size_t>& range : ranges)
+         {
+            sum += stock.minPrice(range.first, range.second);
+            sum += stock.maxPrice(range.first, range.second);
+         }
+         return sum;
+      }));
+   }
+
+   {
+      std::vector<double> macd(series), signal(series), histogram(series);
+      std::span<const double> closes(stock.priceHistory.closes().data(), series);
+      results.push_back(measure("macd.compute", series, "bar", repetitions, [&]
+      {
+         indicators::Macd().compute(closes, macd, signal, histogram);
+         return histogram.back();
+      }));
+   }
+
+   //
+   // Chart, painted into a display list
+   //
+   {
+      const double width = 1600.0;
+      const double height = 900.0;
+      DisplayList list;
+
+      // The first frame of a stock also builds its weekly, monthly... levels.
+      std::unique_ptr<Stock> cold;
+      TradingChart chart;
+      results.push_back(measure("chart.paint.first", 1, "frame", repetitions, [&]
+      {
+         cold = std::make_unique<Stock>();
+         cold->name = stock.name;
+         cold->priceHistory = stock.priceHistory;
+         chart.setStock(cold.get());
+         chart.showBars(series);
+      },
+      [&]
+      {
+         chart.record(list, width, height);
+         return (double)list.size();
+      }));
+
+      // Every frame shows another range, so no cached layer can be used.
+      const size_t frames = 100;
+      chart.setStock(&stock);
+      chart.record(list, width, height);
+      results.push_back(measure("chart.paint.zoom", frames, "frame", repetitions, [&]
+      {
+         for(size_t frame = 0; frame < frames; frame++)
+         {
+            chart.showBars(series >> (frame % 16));
+            chart.record(list, width, height);
+         }
+         return (double)list.size();
+      }));
+
+      // Only the cursor moved, the layers are replayed.
+      chart.showBars(series);
+      chart.record(list, width, height);
+      results.push_back(measure("chart.paint.cached", frames, "frame", repetitions, [&]
+      {
+         for(size_t frame = 0; frame < frames; frame++) chart.record(list, width, height);
+         return (double)list.size();
+      }));
+      std::fprintf(stderr, "%-24s %12zu calls\n", "chart.painterCalls", chart.painterCalls());
+   }
+
+   return writeReport(output,
+                      results,
+                      {{"symbols", symbols},
+                       {"bars", bars},
+                       {"minutes", minutes},
+                       {"series", series},
+                       {"seed", seed},
+                       {"repetitions", (uint64)repetitions},
+                       {"compress", compress}}) ? 0 : 1;
+}
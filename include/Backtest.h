@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        Backtest.h
+// Application: Stock Analyser
+// Purpose:     Backtesting of trading rules and parallel parameter sweeps
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockBacktest_h
+#define StockBacktest_h
+
+#include <span>
+#include <vector>
+
+#include "StockData.h"
+#include "ThreadPool.h"
+
+/*!
+ \brief Backtesting of trading rules on the price history.
+
+ A rule computes the position of every bar over the whole history at once (1 long, 0 flat, -1
+ short, fractions scale the position). The position decided at the close of a bar is held until
+ the close of the next bar. The engine turns the positions into an equity curve, which starts at
+ 1.0, and computes drawdown and trade statistics in one pass.
+
+ A parameter sweep runs a rule for every combination of a parameter grid on every stock. The stocks
+ are only read, so all workers share them. Each worker has its own Scratch with the buffers of the
+ rule and the engine, which are reused for all its runs.
+
+     backtest::ParameterGrid grid;
+     grid.add(5, 20, 1);     // short period
+     grid.add(20, 60, 2);    // long period
+     grid.add(9, 9, 1);      // signal period
+
+     backtest::Engine engine;
+     std::vector<backtest::SweepResult> results =
+        engine.sweep(stocks, backtest::MacdCrossover(), grid);
+ */
+namespace backtest
+{
+   /*!
+    \brief Settings of the engine.
+    */
+   struct Options
+   {
+      //! Costs of a position change as fraction of the traded value (commission and slippage).
+      double commission = 0.0005;
+
+      //! Number of bars per year, used to annualize the Sharpe ratio.
+      double periodsPerYear = 252.0;
+
+      //! Number of workers of sweeps. 0 uses one worker per hardware thread.
+      size_t threads = 0;
+   };
+
+   /*!
+    \brief Result of one backtest.
+    */
+   struct Statistics
+   {
+      //! Equity at the last bar minus 1.
+      double totalReturn = 0.0;
+
+      //! Largest loss from a peak of the equity, as positive fraction of the peak.
+      double maxDrawdown = 0.0;
+
+      //! Annualized Sharpe ratio of the bar returns (without risk free rate).
+      double sharpe = 0.0;
+
+      //! Fraction of the bars, which hold a position.
+      double exposure = 0.0;
+
+      //! Number of trades. A trade lasts as long as the position keeps its sign.
+      size_t trades = 0;
+
+      //! Fraction of the trades with positive return.
+      double winRate = 0.0;
+
+      //! Sum of the returns of the winning trades divided by the losses of the losing trades.
+      //! Infinite, if no trade lost.
+      double profitFactor = 0.0;
+   };
+
+   /*!
+    \brief Equity and drawdown of every bar.
+    */
+   struct EquityCurve
+   {
+      std::vector<double> equity;
+
+      //! Loss from the highest equity up to the bar, as positive fraction.
+      std::vector<double> drawdown;
+   };
+
+   /*!
+    \brief Buffers of one worker, reused for all its backtests.
+    */
+   class alignas(64) Scratch
+   {
+      public:
+
+         /*!
+          \brief Returns the buffer with the index for a rule. Its values are undefined.
+          */
+         std::span<double> buffer(size_t index, size_t size)
+         {
+            if(mBuffers.size() <= index) mBuffers.resize(index + 1);
+            if(mBuffers[index].size() < size) mBuffers[index].resize(size);
+            return std::span<double>(mBuffers[index].data(), size);
+         }
+
+      private:
+
+         friend class Engine;
+
+         std::vector<std::vector<double>> mBuffers;
+
+         std::vector<double> mPositions;
+
+         std::vector<double> mParameters;
+
+         //! Close to close returns of the history mReturnsOf with version mReturnsVersion.
+         std::vector<double> mReturns;
+
+         const PriceHistory* mReturnsOf = nullptr;
+
+         uint64 mReturnsVersion = 0;
+   };
+
+   /*!
+    \brief A trading rule.
+
+    Rules must not have state, which changes during positions(), because the same rule is used by
+    all workers of a sweep. Temporary data belongs into the scratch buffers.
+    */
+   class Rule
+   {
+      public:
+
+         virtual ~Rule() = default;
+
+         /*!
+          \brief Returns the number of parameters.
+          */
+         virtual size_t parameters() const = 0;
+
+         /*!
+          \brief Writes the position of every bar.
+          \param parameters The parameter values, parameters() many.
+          \param positions As long as the history. Bars without decision (e.g. the warm-up of an
+          indicator) must be 0.
+          */
+         virtual void positions(const PriceHistory& history,
+                                std::span<const double> parameters,
+                                Scratch& scratch,
+                                std::span<double> positions) const = 0;
+   };
+
+   /*!
+    \brief Long while the MACD line is above its signal line, optionally short while it is below.
+
+    Parameters: short period, long period and signal period.
+    */
+   class MacdCrossover: public Rule
+   {
+      public:
+
+         explicit MacdCrossover(bool allowShort = false): mAllowShort(allowShort) {}
+
+         size_t parameters() const override { return 3; }
+
+         void positions(const PriceHistory& history,
+                        std::span<const double> parameters,
+                        Scratch& scratch,
+                        std::span<double> positions) const override;
+
+      private:
+
+         bool mAllowShort;
+   };
+
+   /*!
+    \brief Long while the fast simple moving average of the close is above the slow one, optionally
+    short while it is below.
+
+    Parameters: fast period and slow period.
+    */
+   class SmaCrossover: public Rule
+   {
+      public:
+
+         explicit SmaCrossover(bool allowShort = false): mAllowShort(allowShort) {}
+
+         size_t parameters() const override { return 2; }
+
+         void positions(const PriceHistory& history,
+                        std::span<const double> parameters,
+                        Scratch& scratch,
+                        std::span<double> positions) const override;
+
+      private:
+
+         bool mAllowShort;
+   };
+
+   /*!
+    \brief The combinations of the values of all parameters.
+    */
+   class ParameterGrid
+   {
+      public:
+
+         /*!
+          \brief Adds a parameter, which takes the values from first to last (including). If last is
+          before first or the step is not positive, the parameter only takes the value first.
+          */
+         void add(double first, double last, double step);
+
+         /*!
+          \brief Adds a parameter, which takes the values.
+          */
+         void add(std::vector<double> values);
+
+         /*!
+          \brief Returns the number of parameters.
+          */
+         size_t dimensions() const;
+
+         /*!
+          \brief Returns the number of combinations.
+          */
+         size_t size() const;
+
+         /*!
+          \brief Writes the values of the combination. The last parameter changes fastest.
+          */
+         void combination(size_t index, std::span<double> values) const;
+
+      private:
+
+         std::vector<std::vector<double>> mValues;
+   };
+
+   /*!
+    \brief Result of a combination on a stock.
+    */
+   struct SweepResult
+   {
+      //! Index of the stock in the list of the sweep.
+      size_t stock;
+
+      //! Index of the combination in the grid.
+      size_t combination;
+
+      Statistics statistics;
+   };
+
+   /*!
+    \brief Runs backtests on one or many threads.
+    */
+   class Engine
+   {
+      public:
+
+         explicit Engine(const Options& options = Options());
+
+         /*!
+          \brief Runs a backtest of the rule with the parameters. Must not be called during a sweep.
+          \param curve If not null, receives the equity and the drawdown of every bar.
+          */
+         Statistics run(const PriceHistory& history,
+                        const Rule& rule,
+                        std::span<const double> parameters,
+                        EquityCurve* curve = nullptr);
+
+         /*!
+          \brief Runs backtests of all combinations of the grid on all stocks in parallel.
+
+          The runs of a stock are neighbours in the work distribution, so a worker usually runs
+          many combinations on the same stock, whose bars and returns stay in its cache.
+          \return One result per stock and combination, ordered by stock and then by combination.
+          Empty, if the grid does not fit to the rule.
+          */
+         std::vector<SweepResult> sweep(std::span<const Stock* const> stocks,
+                                        const Rule& rule,
+                                        const ParameterGrid& grid);
+
+         /*!
+          \brief Returns the number of workers.
+          */
+         size_t workers() const;
+
+      private:
+
+         Options mOptions;
+
+         ThreadPool mPool;
+
+         //! One scratch per worker.
+         std::vector<Scratch> mScratch;
+
+         Statistics simulate(const PriceHistory& history,
+                             const Rule& rule,
+                             std::span<const double> parameters,
+                             Scratch& scratch,
+                             EquityCurve* curve) const;
+   };
+}
+
+#endif
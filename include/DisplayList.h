@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        DisplayList.h
+// Application: Stock Analyser
+// Purpose:     Recorded painter commands, which can be replayed without recomputing them
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockDisplayList_h
+#define StockDisplayList_h
+
+#include <vector>
+
+#include "Nuitk.h"
+
+/*!
+ \brief A recorded sequence of drawing commands of a painter.
+
+ A chart layer is recorded while it is painted. As long as nothing, which the layer depends on,
+ changes, the next frames replay the commands instead of computing the layer again. Text metrics
+ are not recorded, their results are already part of the recorded positions.
+ */
+class DisplayList
+{
+   public:
+
+      /*!
+       \brief Removes all commands. The memory is kept for the next recording.
+       */
+      void clear();
+
+      /*!
+       \brief Returns true, if the list has no commands.
+       */
+      bool empty() const;
+
+      /*!
+       \brief Returns the number of recorded commands.
+       */
+      size_t size() const;
+
+      void setLineStyle(nui::LineStyle style);
+
+      void setFillColor(const jm::Color& color);
+
+      void setStrokeColor(const jm::Color& color);
+
+      void drawText(const jm::String& text, const jm::Point& point);
+
+      void moveTo(const jm::Point& point);
+
+      void lineTo(const jm::Point& point);
+
+      void line(double x1, double y1, double x2, double y2);
+
+      void rectangle(const jm::Rect& rect);
+
+      void stroke();
+
+      void fill();
+
+      /*!
+       \brief Sends the commands in their recorded order to the painter.
+       */
+      template<class Painter>
+      void replay(Painter* painter) const
+      {
+         for(const Command& command : mCommands)
+         {
+            switch(command.op)
+            {
+               case Op::kLineStyle:
+                  painter->setLineStyle((nui::LineStyle)command.index);
+                  break;
+
+               case Op::kFillColor:
+                  painter->setFillColor(mColors[command.index]);
+                  break;
+
+               case Op::kStrokeColor:
+                  painter->setStrokeColor(mColors[command.index]);
+                  break;
+
+               case Op::kText:
+                  painter->drawText(mTexts[command.index], jm::Point(command.a, command.b));
+                  break;
+
+               case Op::kMoveTo:
+                  painter->moveTo(jm::Point(command.a, command.b));
+                  break;
+
+               case Op::kLineTo:
+                  painter->lineTo(jm::Point(command.a, command.b));
+                  break;
+
+               case Op::kLine:
+                  painter->line(command.a, command.b, command.c, command.d);
+                  break;
+
+               case Op::kRectangle:
+                  painter->rectangle(jm::Rect(command.a, command.b, command.c, command.d));
+                  break;
+
+               case Op::kStroke:
+                  painter->stroke();
+                  break;
+
+               case Op::kFill:
+                  painter->fill();
+                  break;
+            }
+         }
+      }
+
+   private:
+
+      enum class Op : uint8
+      {
+         kLineStyle,
+         kFillColor,
+         kStrokeColor,
+         kText,
+         kMoveTo,
+         kLineTo,
+         kLine,
+         kRectangle,
+         kStroke,
+         kFill
+      };
+
+      /*!
+       \brief A command with its coordinates. Colors, texts and line styles are referenced by the
+       index.
+       */
+      struct Command
+      {
+         Op op;
+         uint32 index;
+         double a;
+         double b;
+         double c;
+         double d;
+      };
+
+      std::vector<Command> mCommands;
+
+      std::vector<jm::Color> mColors;
+
+      std::vector<jm::String> mTexts;
+};
+
+#endif
@@ -0,0 +1,473 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        Indicators.h
+// Application: Stock Analyser
+// Purpose:     Streaming technical indicators (EMA, MACD, RSI, Bollinger Bands, ATR)
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockIndicators_h
+#define StockIndicators_h
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "core/Core.h"
+
+class PriceHistory;
+
+/*!
+ \brief Technical indicators, which are computed bar by bar.
+
+ Every indicator keeps a constant amount of state, which is independent of the length of the
+ history. update() consumes the next bar in O(1) and returns the value at this bar, so appending
+ the newest bar does not touch the older ones. compute() resets the indicator and runs it over a
+ whole column, the results go into buffers of the caller (e.g. from a SeriesPool). The state after
+ compute() is the state after the last bar, so update() can continue with the next one.
+
+ Until an indicator has seen enough bars (warm-up), its value is NaN. Batch outputs have the same
+ length and index as the input, so output[i] belongs to bar i.
+ */
+namespace indicators
+{
+   //! Value of bars before the end of the warm-up.
+   constexpr double kNoValue = std::numeric_limits<double>::quiet_NaN();
+
+   /*!
+    \brief Exponential moving average. The first value is the simple average of the first
+    "period" values.
+    */
+   class Ema
+   {
+      public:
+
+         explicit Ema(int period = 12);
+
+         //! Returns the number of bars before the first value.
+         int warmUp() const { return mPeriod - 1; }
+
+         //! Forgets all bars.
+         void reset();
+
+         //! Returns true, if the warm-up is over.
+         bool ready() const { return mCount >= mPeriod; }
+
+         //! Returns the value at the last bar.
+         double value() const { return ready() ? mValue : kNoValue; }
+
+         //! Consumes the next value and returns the average.
+         double update(double input)
+         {
+            if(mCount >= mPeriod)
+            {
+               mValue += (input - mValue) * mAlpha;
+               return mValue;
+            }
+
+            mValue += input;
+            if(++mCount < mPeriod) return kNoValue;
+
+            mValue /= mPeriod;
+            return mValue;
+         }
+
+         //! Computes the average of all inputs. output must be as long as input.
+         void compute(std::span<const double> input, std::span<double> output);
+
+      private:
+
+         int mPeriod;
+
+         double mAlpha;
+
+         int mCount = 0;
+
+         //! The average, during warm-up the sum.
+         double mValue = 0.0;
+   };
+
+   /*!
+    \brief Value of the MACD at one bar.
+    */
+   struct MacdValue
+   {
+      double macd;
+      double signal;
+      double histogram;
+   };
+
+   /*!
+    \brief Moving average convergence divergence: the difference of a short and a long EMA (MACD
+    line) and an EMA of this difference (signal line).
+    */
+   class Macd
+   {
+      public:
+
+         Macd(int shortPeriod = 12, int longPeriod = 26, int signalPeriod = 9);
+
+         //! Returns the number of bars before the first signal value.
+         int warmUp() const { return mLong.warmUp() + mSignal.warmUp(); }
+
+         void reset();
+
+         //! Consumes the next close. The MACD line starts before the signal line.
+         MacdValue update(double close)
+         {
+            double shortValue = mShort.update(close);
+            double longValue = mLong.update(close);
+
+            if(!mLong.ready()) return MacdValue{kNoValue, kNoValue, kNoValue};
+
+            double macd = shortValue - longValue;
+            double signal = mSignal.update(macd);
+            return MacdValue{macd, signal, macd - signal};
+         }
+
+         //! Computes MACD, signal and histogram. The outputs must be as long as closes.
+         void compute(std::span<const double> closes,
+                      std::span<double> macd,
+                      std::span<double> signal,
+                      std::span<double> histogram);
+
+      private:
+
+         Ema mShort;
+
+         Ema mLong;
+
+         Ema mSignal;
+   };
+
+   /*!
+    \brief Relative strength index with Wilder's smoothing. The values range from 0 to 100.
+    */
+   class Rsi
+   {
+      public:
+
+         explicit Rsi(int period = 14);
+
+         //! Returns the number of bars before the first value.
+         int warmUp() const { return mPeriod; }
+
+         void reset();
+
+         //! Consumes the next close and returns the RSI.
+         double update(double close)
+         {
+            if(mCount == 0)
+            {
+               mCount++;
+               mPrevious = close;
+               return kNoValue;
+            }
+
+            double change = close - mPrevious;
+            double gain = change > 0 ? change : 0.0;
+            double loss = change < 0 ? -change : 0.0;
+            mPrevious = close;
+
+            // Number of changes including this one
+            int changes = mCount;
+            if(changes <= mPeriod) mCount++;
+
+            if(changes < mPeriod)
+            {
+               mGain += gain;
+               mLoss += loss;
+               return kNoValue;
+            }
+
+            if(changes == mPeriod)
+            {
+               // The first averages are simple averages
+               mGain = (mGain + gain) / mPeriod;
+               mLoss = (mLoss + loss) / mPeriod;
+               return value();
+            }
+
+            mGain = (mGain * (mPeriod - 1) + gain) / mPeriod;
+            mLoss = (mLoss * (mPeriod - 1) + loss) / mPeriod;
+            return value();
+         }
+
+         //! Computes the RSI of the closes. output must be as long as closes.
+         void compute(std::span<const double> closes, std::span<double> output);
+
+      private:
+
+         int mPeriod;
+
+         //! Number of closes, counted up to period + 1.
+         int mCount = 0;
+
+         double mPrevious = 0.0;
+
+         //! Average gain, during warm-up the sum.
+         double mGain = 0.0;
+
+         //! Average loss, during warm-up the sum.
+         double mLoss = 0.0;
+
+         double value() const
+         {
+            if(mLoss == 0.0) return mGain == 0.0 ? 50.0 : 100.0;
+            return 100.0 - 100.0 / (1.0 + mGain / mLoss);
+         }
+   };
+
+   /*!
+    \brief Value of the Bollinger Bands at one bar.
+    */
+   struct BollingerValue
+   {
+      double lower;
+      double middle;
+      double upper;
+   };
+
+   /*!
+    \brief Bollinger Bands: simple moving average +/- a multiple of the standard deviation of the
+    last "period" closes (population standard deviation).
+
+    The last "period" closes are kept in a ring buffer. Mean and squared deviations are updated
+    when a close enters and one leaves the window. To keep rounding errors from accumulating, they
+    are recomputed from the window once per "period" bars, which is still O(1) per bar on average.
+    */
+   class Bollinger
+   {
+      public:
+
+         explicit Bollinger(int period = 20, double deviations = 2.0);
+
+         //! Returns the number of bars before the first value.
+         int warmUp() const { return mPeriod - 1; }
+
+         void reset();
+
+         //! Consumes the next close and returns the bands.
+         BollingerValue update(double close);
+
+         //! Computes the bands of the closes. The outputs must be as long as closes.
+         void compute(std::span<const double> closes,
+                      std::span<double> lower,
+                      std::span<double> middle,
+                      std::span<double> upper);
+
+      private:
+
+         int mPeriod;
+
+         double mDeviations;
+
+         //! The last closes, the oldest at mNext once the window is full.
+         std::vector<double> mWindow;
+
+         size_t mCount = 0;
+
+         size_t mNext = 0;
+
+         double mMean = 0.0;
+
+         //! Sum of the squared deviations from the mean.
+         double mSquares = 0.0;
+
+         //! Bars until mean and squares are recomputed.
+         int mUntilResync = 0;
+   };
+
+   /*!
+    \brief Average true range with Wilder's smoothing.
+
+    The true range of a bar is the largest of high - low, |high - previous close| and
+    |low - previous close|. The first bar has no previous close and uses high - low.
+    */
+   class Atr
+   {
+      public:
+
+         explicit Atr(int period = 14);
+
+         //! Returns the number of bars before the first value.
+         int warmUp() const { return mPeriod - 1; }
+
+         void reset();
+
+         //! Consumes the next bar and returns the ATR.
+         double update(double high, double low, double close)
+         {
+            double range = high - low;
+            if(mCount > 0)
+            {
+               range = std::max({range, std::abs(high - mPrevious), std::abs(low - mPrevious)});
+            }
+            mPrevious = close;
+
+            if(mCount >= mPeriod)
+            {
+               mValue = (mValue * (mPeriod - 1) + range) / mPeriod;
+               return mValue;
+            }
+
+            mValue += range;
+            if(++mCount < mPeriod) return kNoValue;
+
+            mValue /= mPeriod;
+            return mValue;
+         }
+
+         //! Computes the ATR of the bars. The columns and output must have the same length.
+         void compute(std::span<const double> highs,
+                      std::span<const double> lows,
+                      std::span<const double> closes,
+                      std::span<double> output);
+
+      private:
+
+         int mPeriod;
+
+         int mCount = 0;
+
+         double mPrevious = 0.0;
+
+         //! The average, during warm-up the sum.
+         double mValue = 0.0;
+   };
+
+   /*!
+    \brief Pool of result buffers, so repeated batch computations do not allocate.
+
+    Buffers are taken with acquire() and given back with release(). The pool is not thread safe,
+    each thread should use its own.
+    */
+   class SeriesPool
+   {
+      public:
+
+         //! Returns a buffer of the size. Its content is undefined.
+         std::vector<double> acquire(size_t size);
+
+         //! Gives the buffer back to the pool.
+         void release(std::vector<double>&& buffer);
+
+         //! Frees all pooled buffers.
+         void clear();
+
+      private:
+
+         std::vector<std::vector<double>> mFree;
+   };
+
+   /*!
+    \brief MACD series, indexed like the bars.
+    */
+   struct MacdSeries
+   {
+      std::span<const double> macd;
+      std::span<const double> signal;
+      std::span<const double> histogram;
+   };
+
+   /*!
+    \brief Bollinger Bands series, indexed like the bars.
+    */
+   struct BollingerSeries
+   {
+      std::span<const double> lower;
+      std::span<const double> middle;
+      std::span<const double> upper;
+   };
+
+   /*!
+    \brief Keeps the computed indicator series of one price history.
+
+    Each series is identified by the indicator type and its parameters and remembers the version of
+    the history it was computed for. As long as the history is unchanged, a request returns the
+    stored series without any computation, so repaints, pans and zooms cost nothing. If bars were
+    appended or the last bar was replaced (see PriceHistory::baseVersion()), the indicator resumes
+    from the state before the last computed bar and only the tail is computed. Any other change
+    (e.g. older bars loaded in front) computes the series again.
+
+    The returned spans are valid until the next request of the same series or clear(). The cache is
+    not thread safe. A copy of the cache is empty.
+    */
+   class IndicatorCache
+   {
+      public:
+
+         IndicatorCache();
+
+         IndicatorCache(const IndicatorCache& other);
+
+         IndicatorCache& operator=(const IndicatorCache& other);
+
+         ~IndicatorCache();
+
+         //! Returns the exponential moving average of the closes.
+         std::span<const double> ema(const PriceHistory& history, int period);
+
+         //! Returns MACD, signal and histogram of the closes.
+         MacdSeries macd(const PriceHistory& history,
+                         int shortPeriod = 12,
+                         int longPeriod = 26,
+                         int signalPeriod = 9);
+
+         //! Returns the relative strength index of the closes.
+         std::span<const double> rsi(const PriceHistory& history, int period = 14);
+
+         //! Returns the Bollinger Bands of the closes.
+         BollingerSeries bollinger(const PriceHistory& history, int period = 20, double deviations = 2.0);
+
+         //! Returns the average true range of the bars.
+         std::span<const double> atr(const PriceHistory& history, int period = 14);
+
+         //! Returns the number of cached series.
+         size_t size() const;
+
+         //! Returns the number of bars computed since the cache was created (for diagnostics).
+         size_t computedBars() const;
+
+         //! Removes all series.
+         void clear();
+
+      private:
+
+         struct Key
+         {
+            int type;
+            double parameters[3];
+
+            bool operator==(const Key& other) const = default;
+         };
+
+         struct Entry;
+
+         template<class Indicator>
+         struct IndicatorEntry;
+
+         std::vector<std::unique_ptr<Entry>> mEntries;
+
+         size_t mComputedBars = 0;
+
+         /*!
+          \brief Returns the entry of the key, created by the factory if missing, and brings it up
+          to date with the history.
+          */
+         template<class Indicator, class Factory>
+         Entry& series(const PriceHistory& history, const Key& key, Factory factory);
+   };
+}
+
+#endif
@@ -0,0 +1,297 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        IngestPipeline.h
+// Application: Stock Analyser
+// Purpose:     Background download and import of the daily prices of many stocks
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockIngestPipeline_h
+#define StockIngestPipeline_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+#include "StockData.h"
+
+/*!
+ \brief Settings of the ingest pipeline.
+ */
+struct IngestOptions
+{
+   //! URL of the query API. The query parameters are appended, so a local server can stand in.
+   jm::String baseUrl = "https://www.alphavantage.co/query";
+
+   //! Alpha Vantage API key.
+   jm::String apiKey;
+
+   //! Number of requests, which may be started per quota period. 0 disables the limit.
+   int requestsPerPeriod = 5;
+
+   //! Length of the quota period.
+   std::chrono::milliseconds quotaPeriod = std::chrono::minutes(1);
+
+   //! Maximum number of simultaneous downloads.
+   int maxConnections = 4;
+
+   //! Timeout of a single download in seconds. 0 waits forever.
+   int timeout = 120;
+
+   //! Number of records, which are written to the database at once.
+   size_t batchSize = 4096;
+
+   //! Maximum number of batches waiting for the writer. The downloads pause, if it is reached.
+   size_t maxQueuedBatches = 64;
+};
+
+/*!
+ \brief State of a running or finished import.
+ */
+struct IngestProgress
+{
+   //! Number of requested symbols.
+   size_t symbols = 0;
+
+   //! Number of symbols, whose download finished (successfully or not).
+   size_t fetched = 0;
+
+   //! Number of symbols, whose prices were completely written.
+   size_t written = 0;
+
+   //! Number of symbols, which failed to download or to write.
+   size_t failed = 0;
+
+   //! Number of written price records.
+   size_t rows = 0;
+
+   //! Number of received bytes.
+   size_t bytes = 0;
+
+   //! True, if the import was cancelled.
+   bool cancelled = false;
+
+   //! True, if the import finished (also if cancelled).
+   bool finished = false;
+};
+
+/*!
+ \brief Token bucket, which limits the number of requests per period.
+
+ The bucket holds up to "requests" tokens and refills continuously with "requests" per period, so
+ a burst of the full quota is allowed after a pause, but the average never exceeds the quota.
+ */
+class RateLimiter
+{
+   public:
+
+      typedef std::chrono::steady_clock Clock;
+
+      /*!
+       \brief Constructor
+       \param requests Number of requests per period. 0 disables the limit.
+       \param period Length of the period.
+       */
+      RateLimiter(int requests, std::chrono::milliseconds period);
+
+      /*!
+       \brief Takes a token, if one is available.
+       \return Zero, if the request may start now. Otherwise the time until the next token is
+       available, no token is taken then.
+       */
+      std::chrono::milliseconds acquire(Clock::time_point now = Clock::now());
+
+   private:
+
+      double mCapacity;
+
+      double mTokens;
+
+      //! Tokens per millisecond.
+      double mRate;
+
+      Clock::time_point mLast;
+};
+
+/*!
+ \brief Downloads and imports the daily prices of many stocks in the background.
+
+ The import runs in three stages:
+  1. A fetch thread downloads up to IngestOptions::maxConnections symbols at once with curl multi.
+     New requests are only started, if the rate limiter allows it.
+  2. The responses are parsed by a PriceCsvParser per download while the data arrives.
+  3. A writer thread with its own database connection writes the parsed batches.
+
+ A full writer queue pauses the downloads, so the memory use is bounded. Missing stocks are added
+ to the database with the symbol as name. A symbol counts as failed, if the download failed, the
+ response contained no prices (e.g. an API message instead of CSV data) or a batch could not be
+ written. Batches of a failed symbol, which were already written, are kept.
+ */
+class IngestPipeline
+{
+   public:
+
+      /*!
+       \brief Receives the progress. Called from the writer thread, after a symbol is finished and
+       once at the end of the import. The handler must pass the progress to the UI thread itself.
+       */
+      typedef std::function<void(const IngestProgress& progress)> ProgressHandler;
+
+      /*!
+       \brief Constructor
+       \param dbFile Path of the database file. The writer opens its own connection.
+       \param dbOptions Settings of the writer connection.
+       \param options Settings of the pipeline.
+       */
+      IngestPipeline(const jm::String& dbFile,
+                     const DatabaseOptions& dbOptions = DatabaseOptions(),
+                     const IngestOptions& options = IngestOptions());
+
+      /*!
+       \brief Destructor. Cancels a running import and waits for the threads.
+       */
+      ~IngestPipeline();
+
+      /*!
+       \brief Starts the import of the symbols and returns immediately.
+       \return False, if an import is still running.
+       */
+      bool start(const std::vector<jm::String>& symbols, ProgressHandler handler = nullptr);
+
+      /*!
+       \brief Requests to stop the import. Running downloads are aborted, queued batches are
+       dropped. Returns immediately, the handler receives the final progress.
+       */
+      void cancel();
+
+      /*!
+       \brief Waits, until the import finished.
+       */
+      void wait();
+
+      /*!
+       \brief Returns true, if an import is running.
+       */
+      bool running() const;
+
+      /*!
+       \brief Returns the current progress. Can be polled from any thread.
+       */
+      IngestProgress progress() const;
+
+      /*!
+       \brief Returns the symbols, which failed. Valid after the import finished.
+       */
+      std::vector<jm::String> failedSymbols() const;
+
+      /*!
+       \brief Returns the query URL of the daily prices of the symbol.
+       */
+      std::string queryUrl(const std::string& symbol) const;
+
+   private:
+
+      struct Transfer;
+
+      /*!
+       \brief Work item of the writer. A batch of records or the end of a symbol.
+       */
+      struct Job
+      {
+         size_t symbol;
+         std::vector<PriceRecord> records;
+
+         //! True, if this is the end of the symbol.
+         bool last = false;
+
+         //! Valid if last: True, if the download succeeded.
+         bool success = false;
+      };
+
+      std::string mDbFile;
+
+      DatabaseOptions mDbOptions;
+
+      IngestOptions mOptions;
+
+      std::vector<std::string> mSymbols;
+
+      ProgressHandler mHandler;
+
+      std::thread mFetchThread;
+
+      std::thread mWriterThread;
+
+      std::atomic<bool> mCancelled = false;
+
+      std::atomic<bool> mRunning = false;
+
+      //! Guards the job queue, the recycled batches, the curl multi handle and the results.
+      mutable std::mutex mMutex;
+
+      std::condition_variable mQueueChanged;
+
+      std::deque<Job> mQueue;
+
+      //! Batches, which the writer returned to be filled again.
+      std::vector<std::vector<PriceRecord>> mFreeBatches;
+
+      //! True, if the fetch thread has queued its last job.
+      bool mFetchDone = false;
+
+      //! Multi handle of the running fetch thread, used to wake it up on cancel.
+      CURLM* mMulti = nullptr;
+
+      std::vector<size_t> mFailed;
+
+      std::atomic<size_t> mFetched = 0;
+
+      std::atomic<size_t> mWritten = 0;
+
+      std::atomic<size_t> mFailedCount = 0;
+
+      std::atomic<size_t> mRows = 0;
+
+      std::atomic<size_t> mBytes = 0;
+
+      /*!
+       \brief Runs the downloads (stages 1 and 2).
+       */
+      void fetch();
+
+      /*!
+       \brief Writes the queued batches (stage 3).
+       */
+      void write();
+
+      /*!
+       \brief Queues a job for the writer. Waits, while the queue is full.
+       \return False, if the import was cancelled.
+       */
+      bool push(Job&& job);
+
+      /*!
+       \brief Returns an empty batch, recycled if possible.
+       */
+      std::vector<PriceRecord> takeBatch();
+
+      void finishTransfer(Transfer* transfer, bool success);
+
+      void reportProgress();
+};
+
+#endif
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        Kernels.h
+// Application: Stock Analyser
+// Purpose:     Vectorized reductions over price and volume columns
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockKernels_h
+#define StockKernels_h
+
+#include <cstddef>
+
+#include "core/Core.h"
+
+/*!
+ \brief Reductions over contiguous price and volume columns (e.g. PriceHistory::closes()).
+
+ Each reduction exists as AVX2, SSE2 and scalar implementation. The best implementation supported
+ by the CPU is selected at runtime on first use. The input must not contain NaN values and must
+ contain at least one value, unless noted otherwise.
+ */
+namespace kernels
+{
+   /*!
+    \brief The instruction sets the kernels are implemented for.
+    */
+   enum class Isa
+   {
+      kScalar,
+      kSSE2,
+      kAVX2
+   };
+
+   /*!
+    \brief Returns the instruction set of the active kernels.
+    */
+   Isa activeIsa();
+
+   /*!
+    \brief Returns the best instruction set supported by the CPU.
+    */
+   Isa supportedIsa();
+
+   /*!
+    \brief Selects the kernels of the instruction set, e.g. to compare them in benchmarks.
+
+    If the CPU does not support the instruction set, the best supported one is selected instead.
+    \return The selected instruction set.
+    */
+   Isa selectIsa(Isa isa);
+
+   /*!
+    \brief Returns the name of the instruction set.
+    */
+   const char* isaName(Isa isa);
+
+   //! Returns the smallest value.
+   double minimum(const double* values, size_t count);
+
+   //! Returns the largest value.
+   double maximum(const double* values, size_t count);
+
+   //! Returns the smallest value.
+   int64 minimum(const int64* values, size_t count);
+
+   //! Returns the largest value.
+   int64 maximum(const int64* values, size_t count);
+
+   //! Returns the sum of the values. Returns 0 for an empty range.
+   double sum(const double* values, size_t count);
+
+   //! Returns the arithmetic mean of the values.
+   double mean(const double* values, size_t count);
+
+   //! Returns the population variance of the values.
+   double variance(const double* values, size_t count);
+
+   /*!
+    \brief Returns the mean true range of the bars.
+
+    The true range of a bar is the largest of high - low, |high - previous close| and
+    |low - previous close|. The first bar has no previous close and uses high - low.
+    */
+   double meanTrueRange(const double* highs, const double* lows, const double* closes, size_t count);
+}
+
+#endif
@@ -0,0 +1,390 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        Pipeline.h
+// Application: Stock Analyser
+// Purpose:     Indicator stages, which are fused into one loop at compile time
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockPipeline_h
+#define StockPipeline_h
+
+#include <array>
+#include <cmath>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "StockData.h"
+
+/*!
+ \brief Indicator pipelines, which are composed of stages at compile time.
+
+ A pipeline is a sequence of stages. Each stage computes one value per bar, either from a column of
+ the bars (field selectors) or from the values of earlier stages, which are referred to by their
+ position in the pipeline. The whole pipeline runs as one loop over the bars, all stages of a bar
+ are evaluated before the next bar, and only the values of the current bar are kept. So there are
+ no intermediate series, and a stage used by several others (e.g. the MACD line) is computed once.
+
+     // 0: close, 1: EMA 12, 2: EMA 26, 3: MACD line, 4: signal line, 5: histogram
+     auto macd = pipeline::make(pipeline::Close(),
+                                pipeline::Ema<0>(12),
+                                pipeline::Ema<0>(26),
+                                pipeline::Difference<1, 2>(),
+                                pipeline::Ema<3>(9),
+                                pipeline::Difference<3, 4>());
+
+     macd.run<3, 4, 5>(history, macdLine, signalLine, histogram);
+
+ As with the indicators, the values of bars before the end of the warm-up are NaN. Stages skip
+ NaN inputs, so a moving average of a stage starts when this stage has its first value.
+ */
+namespace pipeline
+{
+   /*!
+    \brief The columns of the bars, the stages read from.
+    */
+   struct Source
+   {
+      const double* opens;
+      const double* highs;
+      const double* lows;
+      const double* closes;
+      const int64* volumes;
+
+      explicit Source(const PriceHistory& history):
+         opens(history.opens().data()),
+         highs(history.highs().data()),
+         lows(history.lows().data()),
+         closes(history.closes().data()),
+         volumes(history.volumes().data())
+      {
+      }
+   };
+
+   //! Selects the opening price.
+   struct Open
+   {
+      void reset() {}
+
+      double step(const Source& source, size_t index, const double*)
+      {
+         return source.opens[index];
+      }
+   };
+
+   //! Selects the highest price.
+   struct High
+   {
+      void reset() {}
+
+      double step(const Source& source, size_t index, const double*)
+      {
+         return source.highs[index];
+      }
+   };
+
+   //! Selects the lowest price.
+   struct Low
+   {
+      void reset() {}
+
+      double step(const Source& source, size_t index, const double*)
+      {
+         return source.lows[index];
+      }
+   };
+
+   //! Selects the closing price.
+   struct Close
+   {
+      void reset() {}
+
+      double step(const Source& source, size_t index, const double*)
+      {
+         return source.closes[index];
+      }
+   };
+
+   //! Selects the traded volume.
+   struct Volume
+   {
+      void reset() {}
+
+      double step(const Source& source, size_t index, const double*)
+      {
+         return (double)source.volumes[index];
+      }
+   };
+
+   /*!
+    \brief Exponential moving average of the stage Input (see indicators::Ema).
+    */
+   template<size_t Input>
+   class Ema
+   {
+      public:
+
+         static const size_t kInput = Input;
+
+         explicit Ema(int period): mEma(period) {}
+
+         void reset() { mEma.reset(); }
+
+         double step(const Source&, size_t, const double* values)
+         {
+            double input = values[Input];
+            return std::isnan(input) ? indicators::kNoValue : mEma.update(input);
+         }
+
+      private:
+
+         indicators::Ema mEma;
+   };
+
+   /*!
+    \brief Simple moving average of the stage Input.
+
+    The sum is updated when a value enters and one leaves the window. It is computed from the
+    window once per period, so rounding errors do not accumulate.
+    */
+   template<size_t Input>
+   class Sma
+   {
+      public:
+
+         static const size_t kInput = Input;
+
+         explicit Sma(int period): mWindow(std::max(period, 1), 0.0) {}
+
+         void reset()
+         {
+            std::fill(mWindow.begin(), mWindow.end(), 0.0);
+            mCount = 0;
+            mNext = 0;
+            mSum = 0.0;
+         }
+
+         double step(const Source&, size_t, const double* values)
+         {
+            double input = values[Input];
+            if(std::isnan(input)) return indicators::kNoValue;
+
+            size_t period = mWindow.size();
+            mSum += input - mWindow[mNext];
+            mWindow[mNext] = input;
+            if(++mNext == period)
+            {
+               mNext = 0;
+               mSum = 0.0;
+               for(double value : mWindow) mSum += value;
+            }
+
+            if(mCount < period && ++mCount < period) return indicators::kNoValue;
+            return mSum / period;
+         }
+
+      private:
+
+         std::vector<double> mWindow;
+
+         size_t mCount = 0;
+
+         size_t mNext = 0;
+
+         double mSum = 0.0;
+   };
+
+   /*!
+    \brief Difference of the stages A and B (A - B).
+    */
+   template<size_t A, size_t B>
+   struct Difference
+   {
+      static const size_t kInput = A > B ? A : B;
+
+      void reset() {}
+
+      double step(const Source&, size_t, const double* values)
+      {
+         return values[A] - values[B];
+      }
+   };
+
+   /*!
+    \brief Detects crossings of the stages A and B.
+
+    The value is +1, if A crossed above B at this bar, -1, if A crossed below B, and 0 otherwise.
+    Touching B does not count as a crossing until A leaves to the other side.
+    */
+   template<size_t A, size_t B>
+   class Crossover
+   {
+      public:
+
+         static const size_t kInput = A > B ? A : B;
+
+         void reset() { mSide = 0; }
+
+         double step(const Source&, size_t, const double* values)
+         {
+            double difference = values[A] - values[B];
+            if(std::isnan(difference) || difference == 0.0) return 0.0;
+
+            int side = difference > 0.0 ? 1 : -1;
+            int previous = mSide;
+            mSide = side;
+            return previous != 0 && previous != side ? side : 0.0;
+         }
+
+      private:
+
+         //! Side of A at the last bar, where it was not equal to B. 0 at the beginning.
+         int mSide = 0;
+   };
+
+   /*!
+    \brief A sequence of stages, which are evaluated bar by bar in one loop.
+    */
+   template<class... Stages>
+   class Pipeline
+   {
+      public:
+
+         //! Number of stages and values per bar.
+         static const size_t kSize = sizeof...(Stages);
+
+         explicit Pipeline(Stages... stages): mStages(std::move(stages)...)
+         {
+            checkInputs(std::index_sequence_for<Stages...>());
+         }
+
+         /*!
+          \brief Resets all stages.
+          */
+         void reset()
+         {
+            std::apply([](auto&... stage) { (stage.reset(), ...); }, mStages);
+         }
+
+         /*!
+          \brief Evaluates all stages for the next bar.
+          */
+         void update(const Source& source, size_t index)
+         {
+            stepAll(source, index, mValues.data(), std::index_sequence_for<Stages...>());
+         }
+
+         /*!
+          \brief Returns the value of the stage at the last evaluated bar.
+          */
+         template<size_t Stage>
+         double value() const
+         {
+            static_assert(Stage < kSize, "No such stage");
+            return mValues[Stage];
+         }
+
+         /*!
+          \brief Resets the pipeline and runs it over all bars.
+
+          The template arguments select the stages, whose values are written. Each needs an output
+          of the size of the history.
+          */
+         template<size_t... Outputs, class... Spans>
+         void run(const PriceHistory& history, Spans&&... outputs)
+         {
+            static_assert(sizeof...(Outputs) == sizeof...(Spans), "One output per selected stage");
+            static_assert(((Outputs < kSize) && ...), "No such stage");
+
+            constexpr size_t count = sizeof...(Outputs);
+            constexpr std::array<size_t, count> stages = {Outputs...};
+            std::array<double*, count> targets = {std::span<double>(outputs).data()...};
+
+            reset();
+            Source source(history);
+            size_t size = history.size();
+
+            // Local values can be kept in registers.
+            std::array<double, kSize> values = {};
+            for(size_t index = 0; index < size; index++)
+            {
+               stepAll(source, index, values.data(), std::index_sequence_for<Stages...>());
+               for(size_t output = 0; output < count; output++)
+               {
+                  targets[output][index] = values[stages[output]];
+               }
+            }
+            mValues = values;
+         }
+
+      private:
+
+         std::tuple<Stages...> mStages;
+
+         //! Values of the stages at the current bar.
+         std::array<double, kSize> mValues = {};
+
+         template<size_t... Indices>
+         void stepAll(const Source& source,
+                      size_t index,
+                      double* values,
+                      std::index_sequence<Indices...>)
+         {
+            // The comma fold evaluates the stages in order, so every stage sees the values of the
+            // earlier stages of the same bar.
+            ((values[Indices] = std::get<Indices>(mStages).step(source, index, values)), ...);
+         }
+
+         //! Returns true, if the stage has no input or its input is an earlier stage.
+         template<class Stage, size_t Index>
+         static constexpr bool validInput()
+         {
+            if constexpr(requires { Stage::kInput; }) return Stage::kInput < Index;
+            else return true;
+         }
+
+         template<size_t... Indices>
+         static constexpr void checkInputs(std::index_sequence<Indices...>)
+         {
+            static_assert((validInput<Stages, Indices>() && ...),
+                          "A stage can only refer to earlier stages");
+         }
+   };
+
+   /*!
+    \brief Returns a pipeline of the stages.
+    */
+   template<class... Stages>
+   Pipeline<Stages...> make(Stages... stages)
+   {
+      return Pipeline<Stages...>(std::move(stages)...);
+   }
+
+   //! The MACD as pipeline. Stage 3 is the MACD line, 4 the signal line and 5 the histogram.
+   typedef Pipeline<Close, Ema<0>, Ema<0>, Difference<1, 2>, Ema<3>, Difference<3, 4>> MacdPipeline;
+
+   /*!
+    \brief Returns the MACD pipeline. It produces the same values as indicators::Macd.
+    */
+   inline MacdPipeline macd(int shortPeriod = 12, int longPeriod = 26, int signalPeriod = 9)
+   {
+      return MacdPipeline(Close(),
+                          Ema<0>(shortPeriod),
+                          Ema<0>(longPeriod),
+                          Difference<1, 2>(),
+                          Ema<3>(signalPeriod),
+                          Difference<3, 4>());
+   }
+}
+
+#endif
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        PriceChunks.h
+// Application: Stock Analyser
+// Purpose:     Compressed chunks of price bars
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockPriceChunks_h
+#define StockPriceChunks_h
+
+#include <span>
+#include <vector>
+
+#include "StockData.h"
+
+/*!
+ \brief Encoding of consecutive bars of a price history into one compact block.
+
+ A chunk stores the columns one after the other, each with the encoding which suits its values:
+
+     uint8   format version
+     varint  number of bars
+     varint  first time, zigzag encoded
+     varint  first delta of the times, zigzag encoded (only if more than one bar)
+     varint  bytes of the bit stream
+     bits    delta-of-delta times, then the opens, highs, lows and closes
+     varints volumes, zigzag encoded
+
+ The times are day numbers for daily bars and seconds since 1970-01-01 UTC for intraday bars. Their
+ deltas of deltas are zero for regular bars, which takes a single bit (Gorilla encoding, Pelkonen
+ et al. 2015). Each price column starts with its scale. If all its prices are exact decimals with up
+ to four places, as quoted by exchanges, they are written as deltas of the scaled integers.
+ Otherwise each price is XORed with the previous one, identical prices take one bit and similar
+ ones only their differing bits. All multibyte values are written in a defined byte order, so
+ chunks are portable between architectures.
+ */
+namespace chunks
+{
+   //! Maximum number of bars per chunk.
+   const size_t kChunkSize = 2048;
+
+   /*!
+    \brief Encodes count bars of the history from the index first on.
+    \param output Replaced by the chunk.
+    */
+   void encode(const PriceHistory& history, size_t first, size_t count, std::vector<uint8>& output);
+
+   /*!
+    \brief Decodes the chunk and appends its bars directly to the columns of the history. The
+    history must have the interval of the encoded history.
+    \return False, if the chunk is corrupt. The history is unchanged in that case.
+    */
+   bool decode(const uint8* data, size_t size, PriceHistory& history);
+
+   /*!
+    \brief Returns the records as daily history in chronological order. Of records with the same
+    day, the last one is kept.
+    */
+   PriceHistory history(std::span<const PriceRecord> records);
+
+   /*!
+    \brief Returns the records as intraday history in chronological order. Of records with the same
+    time, the last one is kept.
+    */
+   PriceHistory history(BarInterval interval, std::span<const IntradayRecord> records);
+
+   /*!
+    \brief Returns the index of the first bar from the index first on, which starts at or after the
+    time (in seconds).
+    */
+   size_t lowerBound(const PriceHistory& history, int64 time, size_t first = 0);
+
+   /*!
+    \brief Returns the index of the first bar from the index first on, which starts after the time
+    (in seconds).
+    */
+   size_t upperBound(const PriceHistory& history, int64 time, size_t first = 0);
+}
+
+#endif
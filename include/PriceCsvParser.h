@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        PriceCsvParser.h
+// Application: Stock Analyser
+// Purpose:     Streaming parser of daily price CSV data (Alpha Vantage format)
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockPriceCsvParser_h
+#define StockPriceCsvParser_h
+
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "StockData.h"
+
+/*!
+ \brief Parses CSV price data as it arrives, e.g. chunk by chunk from a curl write callback.
+
+ Expected column order (Alpha Vantage "datatype=csv"):
+
+     timestamp,open,high,low,close,volume
+     2025-09-01,229.2500,230.8500,226.9700,229.7200,44075638
+
+ The fields are parsed in place. Only an incomplete line at the end of a chunk and one batch of
+ records are buffered, so the memory use does not depend on the size of the response. A header
+ line and lines which can not be parsed (e.g. an error message instead of data) are skipped and
+ counted.
+ */
+class PriceCsvParser
+{
+   public:
+
+      /*!
+       \brief Receives the parsed records batch by batch.
+       \return False to abort parsing.
+       */
+      typedef std::function<bool(std::span<const PriceRecord> records)> BatchHandler;
+
+      /*!
+       \brief Constructor
+       \param handler Receives the parsed records.
+       \param batchSize Number of records passed to the handler at once.
+       */
+      PriceCsvParser(BatchHandler handler, size_t batchSize = 4096);
+
+      /*!
+       \brief Parses the next chunk of data. Chunks may end anywhere, also inside a line.
+       \return False, if the handler aborted parsing.
+       */
+      bool feed(const char* data, size_t size);
+
+      /*!
+       \brief Parses a last line without line break and passes the remaining records to the
+       handler. Must be called after the last chunk.
+       \return False, if the handler aborted parsing.
+       */
+      bool finish();
+
+      /*!
+       \brief Returns the number of parsed records.
+       */
+      size_t rows() const;
+
+      /*!
+       \brief Returns the number of skipped lines, which were not empty and not the header.
+       */
+      size_t errors() const;
+
+      /*!
+       \brief Write callback for curl (CURLOPT_WRITEFUNCTION), the parser must be passed as
+       CURLOPT_WRITEDATA.
+       */
+      static size_t curlWriteCallback(char* data, size_t size, size_t count, void* parser);
+
+      /*!
+       \brief Parses a decimal number like "229.2500".
+
+       Numbers with up to 19 significant digits and no exponent are converted exactly without
+       locale or allocation, others fall back to strtod.
+       \return False, if the text is not a number.
+       */
+      static bool parseDouble(const char* begin, const char* end, double& value);
+
+   private:
+
+      BatchHandler mHandler;
+
+      size_t mBatchSize;
+
+      std::vector<PriceRecord> mBatch;
+
+      //! Incomplete line of the previous chunk.
+      std::string mCarry;
+
+      //! True, until the first line was read.
+      bool mFirstLine = true;
+
+      //! True, if the handler aborted.
+      bool mAborted = false;
+
+      size_t mRows = 0;
+
+      size_t mErrors = 0;
+
+      void parseLine(const char* begin, const char* end);
+
+      bool flush();
+};
+
+#endif
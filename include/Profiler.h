@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        Profiler.h
+// Application: Stock Analyser
+// Purpose:     Timers and counters of the hot paths, compiled in with STOCKS_PROFILE
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockProfiler_h
+#define StockProfiler_h
+
+#include <string>
+#include <vector>
+
+#include "core/Core.h"
+
+/*!
+ \brief Instrumentation of the chart and the database.
+
+ The code is instrumented with macros, which expand to nothing, unless STOCKS_PROFILE is defined
+ (make PROFILE=1). Their arguments are not evaluated in that case, so production builds have no
+ costs at all.
+
+     PROFILE_SCOPE("db.stock");              // Times the rest of the block
+     PROFILE_BEGIN(scan, "paint.scan");      // Times the code up to PROFILE_END(scan)
+     PROFILE_END(scan);
+     PROFILE_COUNT("db.rows", rows);         // Adds the value to a counter
+
+ Names must be string literals, they are compared by address on the hot path. Each thread records
+ into its own buffer, so threads do not contend. Up to kMaxEvents events per thread are kept for
+ the trace, the summaries include all events.
+ */
+namespace profiler
+{
+   //! Maximum number of events kept per thread for writeTrace().
+   const size_t kMaxEvents = 1 << 18;
+
+   /*!
+    \brief The measurements of a timer or a counter, summed over all threads.
+    */
+   struct Summary
+   {
+      const char* name;
+
+      //! True for counters, false for timers.
+      bool counter;
+
+      //! Number of measurements.
+      uint64 count;
+
+      //! Sum of all durations (in nanoseconds) or counter values.
+      int64 total;
+
+      //! Duration or value of the latest measurement.
+      int64 last;
+
+      //! Longest duration or largest value.
+      int64 maximum;
+
+      //! Time of the latest measurement in nanoseconds.
+      int64 time;
+   };
+
+   /*!
+    \brief Returns true, if the instrumentation is compiled in.
+    */
+   bool enabled();
+
+   /*!
+    \brief Returns the summaries of all timers and counters, ordered by name.
+    */
+   std::vector<Summary> summary();
+
+   /*!
+    \brief Returns the summary of the timer or counter.
+    \return False, if it was not measured yet.
+    */
+   bool summary(const char* name, Summary& result);
+
+   /*!
+    \brief Removes all events and summaries.
+    */
+   void reset();
+
+   /*!
+    \brief Writes all kept events as Chrome trace JSON (chrome://tracing, Perfetto).
+    \return False, if the file could not be written or the instrumentation is not compiled in.
+    */
+   bool writeTrace(const std::string& file);
+
+#ifdef STOCKS_PROFILE
+
+   /*!
+    \brief Returns the time in nanoseconds since the start of the process.
+    */
+   int64 now();
+
+   /*!
+    \brief Records a duration of a timer.
+    */
+   void record(const char* name, int64 start, int64 duration);
+
+   /*!
+    \brief Adds a value to a counter.
+    */
+   void count(const char* name, int64 value);
+
+   /*!
+    \brief Times from construction to stop() or destruction.
+    */
+   class Scope
+   {
+      public:
+
+         explicit Scope(const char* name): mName(name), mStart(now()) {}
+
+         ~Scope() { stop(); }
+
+         Scope(const Scope&) = delete;
+         Scope& operator=(const Scope&) = delete;
+
+         void stop()
+         {
+            if(mName == nullptr) return;
+            record(mName, mStart, now() - mStart);
+            mName = nullptr;
+         }
+
+      private:
+
+         const char* mName;
+
+         int64 mStart;
+   };
+
+#endif
+}
+
+#ifdef STOCKS_PROFILE
+
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+
+#define PROFILE_SCOPE(name) profiler::Scope PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_BEGIN(scope, name) profiler::Scope profile_##scope(name)
+#define PROFILE_END(scope) profile_##scope.stop()
+#define PROFILE_COUNT(name, value) profiler::count(name, (int64)(value))
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_BEGIN(scope, name)
+#define PROFILE_END(scope)
+#define PROFILE_COUNT(name, value)
+
+#endif
+
+#endif
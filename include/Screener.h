@@ -0,0 +1,163 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        Screener.h
+// Application: Stock Analyser
+// Purpose:     Parallel screening of all stocks of the database
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockScreener_h
+#define StockScreener_h
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "StockData.h"
+#include "ThreadPool.h"
+
+/*!
+ \brief Settings of the screener.
+ */
+struct ScreenerOptions
+{
+   //! Number of latest bars loaded per stock. Must cover the longest period of the conditions.
+   size_t bars = 400;
+
+   //! Number of workers. 0 uses one worker per hardware thread.
+   size_t threads = 0;
+
+   //! Maximum number of results. 0 returns all matching stocks.
+   size_t limit = 0;
+};
+
+/*!
+ \brief A stock, which matched all conditions.
+ */
+struct ScreenerResult
+{
+   jm::String symbol;
+
+   //! Score of the stock, the results are ordered by it (highest first).
+   double score;
+
+   //! Close of the latest bar.
+   double close;
+
+   //! Date of the latest bar.
+   jm::Date date;
+};
+
+/*!
+ \brief Evaluates conditions for all stocks of the database and ranks the matching stocks.
+
+ The stocks are distributed over a work stealing thread pool. Every worker has its own read
+ connection to the database, which is kept for the lifetime of the screener, and loads only the
+ latest ScreenerOptions::bars bars of each stock. Conditions and score are evaluated on the worker
+ threads, so they must not modify shared state.
+
+     Screener screener("stocks.db");
+     screener.addCondition(Screener::closeAboveSma(200));
+     screener.addCondition(Screener::rsiBelow(30));
+     screener.setScore([](const Stock& stock) { return -Screener::rsi(stock.priceHistory); });
+     std::vector<ScreenerResult> results = screener.run();
+ */
+class Screener
+{
+   public:
+
+      /*!
+       \brief Returns true, if the stock matches.
+       */
+      typedef std::function<bool(const Stock& stock)> Condition;
+
+      /*!
+       \brief Returns the score of a matching stock. Higher scores rank first.
+       */
+      typedef std::function<double(const Stock& stock)> Score;
+
+      /*!
+       \brief Constructor
+       \param dbFile Path of the database file.
+       \param dbOptions Settings of the worker connections.
+       \param options Settings of the screener.
+       */
+      Screener(const jm::String& dbFile,
+               const DatabaseOptions& dbOptions = DatabaseOptions(),
+               const ScreenerOptions& options = ScreenerOptions());
+
+      ~Screener();
+
+      /*!
+       \brief Adds a condition. A stock matches, if it has at least one bar and all conditions are
+       true.
+       */
+      void addCondition(Condition condition);
+
+      /*!
+       \brief Removes all conditions.
+       */
+      void clearConditions();
+
+      /*!
+       \brief Sets the score. Without score, all results have score 0 and are ordered by symbol.
+       */
+      void setScore(Score score);
+
+      /*!
+       \brief Screens all stocks of the database.
+       \return The matching stocks, ordered by descending score and then by symbol.
+       */
+      std::vector<ScreenerResult> run();
+
+      /*!
+       \brief Returns the number of workers.
+       */
+      size_t workers() const;
+
+      /*!
+       \brief Returns the simple moving average of the latest closes or NaN, if the history is
+       shorter than the period.
+       */
+      static double sma(const PriceHistory& history, int period);
+
+      /*!
+       \brief Returns the RSI at the latest bar, computed over the whole history.
+       */
+      static double rsi(const PriceHistory& history, int period = 14);
+
+      //! Close of the latest bar is above its simple moving average.
+      static Condition closeAboveSma(int period);
+
+      //! Close of the latest bar is below its simple moving average.
+      static Condition closeBelowSma(int period);
+
+      //! RSI of the latest bar is below the level.
+      static Condition rsiBelow(double level, int period = 14);
+
+      //! RSI of the latest bar is above the level.
+      static Condition rsiAbove(double level, int period = 14);
+
+   private:
+
+      ScreenerOptions mOptions;
+
+      std::vector<Condition> mConditions;
+
+      Score mScore;
+
+      ThreadPool mPool;
+
+      //! One connection per worker.
+      std::vector<std::unique_ptr<StockDatabase>> mConnections;
+};
+
+#endif
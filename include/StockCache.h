@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        StockCache.h
+// Application: Stock Analyser
+// Purpose:     Shared stocks with a memory budget
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockCache_h
+#define StockCache_h
+
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "StockData.h"
+
+/*!
+ \brief Hands out shared, immutable stocks by symbol.
+
+ The cache keeps the most recently used stocks as long as their histories fit into the memory
+ budget. Older ones are evicted, but a stock, which is still used somewhere, is handed out again
+ instead of being loaded a second time. So a symbol is in memory only once.
+
+ The cache is thread safe and may be shared by several connections. If a symbol is requested while
+ it is loaded, the request waits for that load instead of starting another one.
+
+ The stocks are immutable except for their indicator cache and price levels, which are filled on
+ demand and are not thread safe (see Stock). So a shared stock may be used by only one thread at a
+ time, e.g. by the charts on the UI thread.
+ */
+class StockCache
+{
+   public:
+
+      /*!
+       \brief Loads the stock, returns nullptr if it does not exist.
+       */
+      typedef std::function<std::shared_ptr<const Stock>()> Loader;
+
+      /*!
+       \brief Counts of the requests since the cache was created.
+       */
+      struct Statistics
+      {
+         //! Requests of a cached or still used stock.
+         uint64 hits = 0;
+
+         //! Requests, which loaded the stock.
+         uint64 loads = 0;
+
+         //! Requests, which waited for the load of another request.
+         uint64 waits = 0;
+
+         //! Stocks removed from the cache to keep the budget.
+         uint64 evictions = 0;
+      };
+
+      /*!
+       \param budget Memory budget in bytes for the histories of the cached stocks.
+       */
+      explicit StockCache(size_t budget);
+
+      /*!
+       \brief Returns the stock of the symbol. If it is neither cached nor used somewhere, it is
+       loaded by the loader. An exception of the loader is passed on, also to the requests waiting
+       for the load, and the next request loads again.
+       \return The stock or nullptr, if the loader returned nullptr. Missing stocks are not cached.
+       */
+      std::shared_ptr<const Stock> get(const jm::String& symbol, const Loader& load);
+
+      /*!
+       \brief Forgets the stock of the symbol, e.g. after its prices changed. Users of the stock
+       keep their instance, the next request loads a new one.
+       */
+      void invalidate(const jm::String& symbol);
+
+      /*!
+       \brief Forgets all stocks.
+       */
+      void clear();
+
+      /*!
+       \brief Sets the memory budget in bytes and evicts stocks, until they fit into it.
+       */
+      void setBudget(size_t budget);
+
+      /*!
+       \brief Returns the memory budget in bytes.
+       */
+      size_t budget() const;
+
+      /*!
+       \brief Returns the bytes of the cached histories.
+       */
+      size_t memoryUsage() const;
+
+      /*!
+       \brief Returns the number of cached stocks.
+       */
+      size_t size() const;
+
+      Statistics statistics() const;
+
+   private:
+
+      struct Entry
+      {
+         //! The stock, while it is cached.
+         std::shared_ptr<const Stock> stock;
+
+         //! The stock, as long as anyone uses it, also after its eviction.
+         std::weak_ptr<const Stock> used;
+
+         //! Memory usage of the history, while it is cached.
+         size_t bytes = 0;
+
+         //! Position in mRecent, while it is cached.
+         std::list<std::string>::iterator recent;
+
+         //! The running load, which requests of the symbol wait for.
+         std::shared_future<std::shared_ptr<const Stock>> loading;
+
+         //! Identifies the running load. An invalidation during the load drops its result.
+         uint64 load = 0;
+      };
+
+      mutable std::mutex mMutex;
+
+      std::unordered_map<std::string, Entry> mEntries;
+
+      //! Symbols of the cached stocks, most recently used first.
+      std::list<std::string> mRecent;
+
+      size_t mBudget;
+
+      size_t mMemoryUsage = 0;
+
+      uint64 mLoads = 0;
+
+      Statistics mStatistics;
+
+      /*!
+       \brief Caches the stock as most recently used and evicts stocks over the budget.
+       */
+      void admit(const std::string& key, Entry& entry, std::shared_ptr<const Stock> stock);
+
+      /*!
+       \brief Removes the stock from the cache. The entry is kept, while the stock is used.
+       */
+      void evict(Entry& entry);
+
+      /*!
+       \brief Evicts the least recently used stocks until the cached ones fit into the budget.
+       */
+      void trim();
+};
+
+#endif
@@ -0,0 +1,1513 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        StockData.h
+// Application: Stock Analyser
+// Purpose:     Price data and the stock database, without user interface
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockData_h
+#define StockData_h
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <sqlite3.h>
+
+#include "core/Core.h"
+
+#include "Indicators.h"
+
+/*!
+ \brief The price record for one period (usually a day).
+ */
+struct PriceRecord
+{
+   jm::Date date;
+   double open;
+   double high;
+   double low;
+   double close;
+   int64 volume;
+};
+
+/*!
+ \brief Duration of the bars of a price history in seconds.
+ */
+enum class BarInterval : int32
+{
+   kMinute = 60,
+   kFiveMinutes = 300,
+   kFifteenMinutes = 900,
+   kHour = 3600,
+   kDay = 86400
+};
+
+/*!
+ \brief The price record for one intraday bar.
+ */
+struct IntradayRecord
+{
+   //! Start of the bar in seconds since 1970-01-01 00:00 UTC.
+   int64 time;
+   double open;
+   double high;
+   double low;
+   double close;
+   int64 volume;
+};
+
+//! Seconds of a day.
+const int64 kSecondsPerDay = 86400;
+
+/*!
+ \brief Returns the day number (days since 1970-01-01) of the time in seconds since 1970-01-01 UTC.
+ */
+inline int32 timeToDays(int64 time)
+{
+   return (int32)(time >= 0 ? time / kSecondsPerDay : (time - kSecondsPerDay + 1) / kSecondsPerDay);
+}
+
+/*!
+ \brief Returns the number of days since 1970-01-01 (proleptic Gregorian calendar).
+ */
+inline int32 daysFromCivil(int32 year, int32 month, int32 day)
+{
+   year -= month <= 2;
+   const int32 era = (year >= 0 ? year : year - 399) / 400;
+   const int32 yoe = year - era * 400;
+   const int32 doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+   const int32 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+   return era * 146097 + doe - 719468;
+}
+
+/*!
+ \brief Returns the day number (days since 1970-01-01) of the date.
+ */
+inline int32 dateToDays(const jm::Date& date)
+{
+   return daysFromCivil(date.year(), date.month() + 1, date.date());
+}
+
+/*!
+ \brief Converts the day number (days since 1970-01-01) into year, month (1-12) and day (1-31).
+ */
+inline void civilFromDays(int32 days, int32& year, int32& month, int32& day)
+{
+   days += 719468;
+   const int32 era = (days >= 0 ? days : days - 146096) / 146097;
+   const int32 doe = days - era * 146097;
+   const int32 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+   const int32 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+   const int32 mp = (5 * doy + 2) / 153;
+   day = doy - (153 * mp + 2) / 5 + 1;
+   month = mp < 10 ? mp + 3 : mp - 9;
+   year = yoe + era * 400 + (month <= 2);
+}
+
+/*!
+ \brief Returns the date of the day number (days since 1970-01-01).
+ */
+inline jm::Date daysToDate(int32 days)
+{
+   int32 year, month, day;
+   civilFromDays(days, year, month, day);
+   return jm::Date(year, month - 1, day);
+}
+
+/*!
+ \brief Answers minimum or maximum queries over any range of a column in constant time.
+
+ The column is divided into blocks of kBlockSize values. A sparse table over the block extrema
+ answers the whole blocks of a range with two lookups, only the partial blocks at both ends are
+ scanned. Appending values updates one entry per table level, so it costs O(log n). The index
+ does not copy the column, the same column must be passed to every call.
+
+ \tparam Compare std::less for minimum queries, std::greater for maximum queries.
+ */
+template<typename T, typename Compare>
+class RangeIndex
+{
+   public:
+
+      //! Number of values per block.
+      static const size_t kBlockSize = 32;
+
+      /*!
+       \brief Indexes the values appended to the column since the last call.
+       */
+      void extend(std::span<const T> values)
+      {
+         size_t size = values.size();
+         if(size <= mSize) return;
+
+         if(mTable.empty()) mTable.emplace_back();
+
+         size_t block = mSize / kBlockSize;
+         size_t lastBlock = (size - 1) / kBlockSize;
+
+         for(; block <= lastBlock; block++)
+         {
+            // Not kept as reference, updateLevels() may grow the table.
+            std::vector<T>& blocks = mTable[0];
+
+            size_t index = std::max(mSize, block * kBlockSize);
+            size_t end = std::min(size, (block + 1) * kBlockSize);
+
+            // A block, which is indexed from its start again, is not merged with its old extremum.
+            bool merge = block < blocks.size() && index > block * kBlockSize;
+            T value = merge ? blocks[block] : values[index];
+            for(; index < end; index++) value = best(value, values[index]);
+
+            if(block < blocks.size()) blocks[block] = value;
+            else blocks.push_back(value);
+
+            updateLevels(block);
+         }
+
+         mSize = size;
+      }
+
+      /*!
+       \brief Forgets the values from the index on, e.g. before they are modified. They are indexed
+       again by the next extend().
+       */
+      void truncate(size_t size)
+      {
+         mSize = std::min(mSize, size / kBlockSize * kBlockSize);
+      }
+
+      /*!
+       \brief Rebuilds the index for the column, e.g. after values were inserted in front.
+       */
+      void rebuild(std::span<const T> values)
+      {
+         mTable.clear();
+         mSize = 0;
+         extend(values);
+      }
+
+      /*!
+       \brief Returns the minimum (maximum) of the column values in the range.
+       \param first First index of range (including)
+       \param last Last index of range (including)
+       */
+      T query(std::span<const T> values, size_t first, size_t last) const
+      {
+         size_t firstBlock = first / kBlockSize;
+         size_t lastBlock = last / kBlockSize;
+
+         if(firstBlock == lastBlock) return scan(values, first, last);
+
+         T value = best(scan(values, first, (firstBlock + 1) * kBlockSize - 1),
+                        scan(values, lastBlock * kBlockSize, last));
+
+         if(firstBlock + 1 < lastBlock)
+         {
+            size_t from = firstBlock + 1;
+            size_t count = lastBlock - from;
+            size_t level = std::bit_width(count) - 1;
+            value = best(value, best(mTable[level][from],
+                                     mTable[level][lastBlock - (size_t(1) << level)]));
+         }
+         return value;
+      }
+
+      /*!
+       \brief Returns the bytes allocated by the index.
+       */
+      size_t memoryUsage() const
+      {
+         size_t bytes = 0;
+         for(const std::vector<T>& level : mTable) bytes += level.capacity() * sizeof(T);
+         return bytes;
+      }
+
+   private:
+
+      //! Number of indexed values.
+      size_t mSize = 0;
+
+      //! mTable[k][b] is the extremum of the blocks b to b+2^k-1.
+      std::vector<std::vector<T>> mTable;
+
+      static T best(const T& a, const T& b)
+      {
+         return Compare()(b, a) ? b : a;
+      }
+
+      static T scan(std::span<const T> values, size_t first, size_t last)
+      {
+         T value = values[first];
+         for(size_t index = first + 1; index <= last; index++) value = best(value, values[index]);
+         return value;
+      }
+
+      /*!
+       \brief Updates the table entries, which end at the block.
+       */
+      void updateLevels(size_t block)
+      {
+         for(size_t level = 1; (size_t(1) << level) <= block + 1; level++)
+         {
+            size_t half = size_t(1) << (level - 1);
+            size_t index = block + 1 - (half << 1);
+            T value = best(mTable[level - 1][index], mTable[level - 1][index + half]);
+
+            if(mTable.size() <= level) mTable.emplace_back();
+            if(index < mTable[level].size()) mTable[level][index] = value;
+            else mTable[level].push_back(value);
+         }
+      }
+};
+
+/*!
+ \brief A column of values.
+
+ The values are either owned or borrowed from external memory, e.g. a memory mapped snapshot file.
+ A borrowed column is copied into owned memory on the first modification.
+ */
+template<typename T>
+class Column
+{
+   public:
+
+      Column() = default;
+
+      Column(const Column& other)
+      {
+         *this = other;
+      }
+
+      Column& operator=(const Column& other)
+      {
+         if(this == &other) return *this;
+         mValues = other.mValues;
+         mBorrowed = other.mBorrowed;
+         mData = mBorrowed ? other.mData : mValues.data();
+         mSize = other.mSize;
+         return *this;
+      }
+
+      Column(Column&& other) noexcept
+      {
+         *this = std::move(other);
+      }
+
+      Column& operator=(Column&& other) noexcept
+      {
+         mValues = std::move(other.mValues);
+         mBorrowed = other.mBorrowed;
+         mData = mBorrowed ? other.mData : mValues.data();
+         mSize = other.mSize;
+         other.mData = nullptr;
+         other.mSize = 0;
+         other.mBorrowed = false;
+         return *this;
+      }
+
+      size_t size() const { return mSize; }
+
+      bool empty() const { return mSize == 0; }
+
+      const T* data() const { return mData; }
+
+      const T* begin() const { return mData; }
+
+      const T* end() const { return mData + mSize; }
+
+      const T& operator[](size_t index) const { return mData[index]; }
+
+      const T& front() const { return mData[0]; }
+
+      const T& back() const { return mData[mSize - 1]; }
+
+      operator std::span<const T>() const { return std::span<const T>(mData, mSize); }
+
+      /*!
+       \brief Returns true, if the values are borrowed from external memory.
+       */
+      bool borrowed() const { return mBorrowed; }
+
+      /*!
+       \brief Returns the bytes of the values, borrowed values included.
+       */
+      size_t memoryUsage() const
+      {
+         return (mBorrowed ? mSize : mValues.capacity()) * sizeof(T);
+      }
+
+      /*!
+       \brief Refers to the external values. The memory must outlive the column or its first
+       modification.
+       */
+      void borrow(const T* values, size_t size)
+      {
+         mValues = std::vector<T>();
+         mData = values;
+         mSize = size;
+         mBorrowed = true;
+      }
+
+      void reserve(size_t size)
+      {
+         own();
+         mValues.reserve(size);
+         sync();
+      }
+
+      void push_back(const T& value)
+      {
+         own();
+         mValues.push_back(value);
+         sync();
+      }
+
+      /*!
+       \brief Appends count values and returns them for writing.
+       */
+      T* extend(size_t count)
+      {
+         own();
+         mValues.resize(mValues.size() + count);
+         sync();
+         return mValues.data() + mSize - count;
+      }
+
+      /*!
+       \brief Removes the values from the index on.
+       */
+      void truncate(size_t size)
+      {
+         own();
+         mValues.resize(size);
+         sync();
+      }
+
+      /*!
+       \brief Replaces the last value.
+       */
+      void replaceBack(const T& value)
+      {
+         own();
+         mValues.back() = value;
+      }
+
+      /*!
+       \brief Inserts the values in front of the column.
+       */
+      void prepend(std::span<const T> values)
+      {
+         own();
+         mValues.insert(mValues.begin(), values.begin(), values.end());
+         sync();
+      }
+
+   private:
+
+      std::vector<T> mValues;
+      const T* mData = nullptr;
+      size_t mSize = 0;
+      bool mBorrowed = false;
+
+      void own()
+      {
+         if(!mBorrowed) return;
+         mValues.assign(mData, mData + mSize);
+         mBorrowed = false;
+         sync();
+      }
+
+      void sync()
+      {
+         mData = mValues.data();
+         mSize = mValues.size();
+      }
+};
+
+/*!
+ \brief Column-oriented price history.
+
+ Each field of the price records is stored in its own contiguous array and the date is stored as
+ day number (days since 1970-01-01), so a scan over one field only touches that field. The index
+ operator assembles a PriceRecord for call sites which need the whole record.
+
+ An intraday history additionally stores the start time of each bar in seconds since 1970-01-01
+ UTC. Its day numbers are the UTC days of the start times, so code working on days (levels,
+ indicators, screens) also works on intraday bars. Daily histories have no time column.
+
+ Range indices over the lows, highs and volumes are kept up to date with every change, so the
+ extrema of any range are answered in constant time.
+
+ The columns may refer to a memory mapped snapshot (see fromColumns()). They are copied on the
+ first modification.
+
+ Every modification assigns a new version, so derived data (e.g. indicators) can tell whether it is
+ still up to date. Versions are unique across all histories.
+ */
+class PriceHistory
+{
+   public:
+
+      /*!
+       \param interval Duration of the bars. Intraday bars are appended with appendIntraday().
+       */
+      explicit PriceHistory(BarInterval interval = BarInterval::kDay): mInterval(interval) {}
+
+      /*!
+       \brief Returns the number of bars.
+       */
+      size_t size() const
+      {
+         return mDays.size();
+      }
+
+      /*!
+       \brief Returns the duration of the bars.
+       */
+      BarInterval interval() const
+      {
+         return mInterval;
+      }
+
+      /*!
+       \brief Returns true, if the bars are shorter than a day and have a start time.
+       */
+      bool intraday() const
+      {
+         return mInterval != BarInterval::kDay;
+      }
+
+      /*!
+       \brief Returns true, if the history contains no bars.
+       */
+      bool empty() const
+      {
+         return mDays.empty();
+      }
+
+      /*!
+       \brief Returns the bytes of the columns and their range indices.
+       */
+      size_t memoryUsage() const
+      {
+         return mDays.memoryUsage() + mTimes.memoryUsage() + mOpen.memoryUsage() + mHigh.memoryUsage() +
+                mLow.memoryUsage() + mClose.memoryUsage() + mVolume.memoryUsage() +
+                mLowIndex.memoryUsage() + mHighIndex.memoryUsage() + mVolumeIndex.memoryUsage();
+      }
+
+      /*!
+       \brief Returns the record of the bar at the index.
+       */
+      PriceRecord operator[](size_t index) const
+      {
+         return {daysToDate(mDays[index]),
+                 mOpen[index],
+                 mHigh[index],
+                 mLow[index],
+                 mClose[index],
+                 mVolume[index]};
+      }
+
+      /*!
+       \brief Returns the date of the bar at the index.
+       */
+      jm::Date date(size_t index) const
+      {
+         return daysToDate(mDays[index]);
+      }
+
+      /*!
+       \brief Returns the start time of the bar at the index in seconds since 1970-01-01 UTC. Daily
+       bars start at midnight.
+       */
+      int64 time(size_t index) const
+      {
+         return intraday() ? mTimes[index] : mDays[index] * kSecondsPerDay;
+      }
+
+      //! Day numbers (days since 1970-01-01) of the bars.
+      const Column<int32>& days() const { return mDays; }
+
+      //! Start times of intraday bars in seconds since 1970-01-01 UTC, empty for daily bars.
+      const Column<int64>& times() const { return mTimes; }
+
+      //! Opening prices of the bars.
+      const Column<double>& opens() const { return mOpen; }
+
+      //! Highest prices of the bars.
+      const Column<double>& highs() const { return mHigh; }
+
+      //! Lowest prices of the bars.
+      const Column<double>& lows() const { return mLow; }
+
+      //! Closing prices of the bars.
+      const Column<double>& closes() const { return mClose; }
+
+      //! Traded volumes of the bars.
+      const Column<int64>& volumes() const { return mVolume; }
+
+      /*!
+       \brief Returns the version of the bars, it changes with every modification.
+       */
+      uint64 version() const
+      {
+         return mVersion;
+      }
+
+      /*!
+       \brief Returns the version of the older bars. It does not change, if bars are appended or the
+       last bar is replaced, so values derived from all bars but the last one are still valid.
+       */
+      uint64 baseVersion() const
+      {
+         return mBaseVersion;
+      }
+
+      /*!
+       \brief Returns the lowest price in the range.
+       \param first First index of range (including)
+       \param last Last index of range (including)
+       */
+      double minLow(size_t first, size_t last) const
+      {
+         return mLowIndex.query(mLow, first, last);
+      }
+
+      /*!
+       \brief Returns the highest price in the range.
+       \param first First index of range (including)
+       \param last Last index of range (including)
+       */
+      double maxHigh(size_t first, size_t last) const
+      {
+         return mHighIndex.query(mHigh, first, last);
+      }
+
+      /*!
+       \brief Returns the highest volume in the range.
+       \param first First index of range (including)
+       \param last Last index of range (including)
+       */
+      int64 maxVolume(size_t first, size_t last) const
+      {
+         return mVolumeIndex.query(mVolume, first, last);
+      }
+
+      /*!
+       \brief The columns of bars added by appendBars(). times is nullptr for daily bars.
+       */
+      struct Bars
+      {
+         int32* days;
+         int64* times;
+         double* opens;
+         double* highs;
+         double* lows;
+         double* closes;
+         int64* volumes;
+      };
+
+      /*!
+       \brief Returns a history, which refers to the columns without copying them.
+       \param storage Owner of the column memory, kept alive as long as any column refers to it.
+       */
+      static PriceHistory fromColumns(std::shared_ptr<const void> storage,
+                                      size_t size,
+                                      const int32* days,
+                                      const double* opens,
+                                      const double* highs,
+                                      const double* lows,
+                                      const double* closes,
+                                      const int64* volumes)
+      {
+         PriceHistory history;
+         history.mStorage = std::move(storage);
+         history.mDays.borrow(days, size);
+         history.mOpen.borrow(opens, size);
+         history.mHigh.borrow(highs, size);
+         history.mLow.borrow(lows, size);
+         history.mClose.borrow(closes, size);
+         history.mVolume.borrow(volumes, size);
+         history.mLowIndex.extend(history.mLow);
+         history.mHighIndex.extend(history.mHigh);
+         history.mVolumeIndex.extend(history.mVolume);
+         return history;
+      }
+
+      /*!
+       \brief Reserves memory for the number of bars in all columns.
+       */
+      void reserve(size_t size)
+      {
+         mDays.reserve(size);
+         if(intraday()) mTimes.reserve(size);
+         mOpen.reserve(size);
+         mHigh.reserve(size);
+         mLow.reserve(size);
+         mClose.reserve(size);
+         mVolume.reserve(size);
+      }
+
+      /*!
+       \brief Appends one daily bar. Bars must be appended in chronological order.
+       \return False, if the history is intraday. Its bars need a time, see appendIntraday().
+       */
+      bool append(int32 day, double open, double high, double low, double close, int64 volume)
+      {
+         if(intraday()) return false;
+         appendBar(day, open, high, low, close, volume);
+         return true;
+      }
+
+      /*!
+       \brief Appends one daily bar. Bars must be appended in chronological order.
+       \return False, if the history is intraday.
+       */
+      bool append(const PriceRecord& record)
+      {
+         return append(dateToDays(record.date),
+                       record.open,
+                       record.high,
+                       record.low,
+                       record.close,
+                       record.volume);
+      }
+
+      /*!
+       \brief Appends count bars, which are written directly into the columns, e.g. by a decoder.
+       Bars must be appended in chronological order.
+       \param fill Called once with the new bars. Returns false, if it could not write them, they
+       are removed again in that case.
+       \return The result of fill.
+       */
+      template<typename Fill>
+      bool appendBars(size_t count, Fill fill)
+      {
+         if(count == 0) return true;
+
+         size_t size = this->size();
+         Bars bars = {mDays.extend(count),
+                      intraday() ? mTimes.extend(count) : nullptr,
+                      mOpen.extend(count),
+                      mHigh.extend(count),
+                      mLow.extend(count),
+                      mClose.extend(count),
+                      mVolume.extend(count)};
+
+         if(!fill(bars))
+         {
+            mDays.truncate(size);
+            if(intraday()) mTimes.truncate(size);
+            mOpen.truncate(size);
+            mHigh.truncate(size);
+            mLow.truncate(size);
+            mClose.truncate(size);
+            mVolume.truncate(size);
+            return false;
+         }
+
+         mLowIndex.extend(mLow);
+         mHighIndex.extend(mHigh);
+         mVolumeIndex.extend(mVolume);
+
+         mVersion = nextVersion();
+         return true;
+      }
+
+      /*!
+       \brief Appends count bars of the other history from the index first on. Both histories must
+       have the same interval.
+       \return False, if only one of the histories is intraday.
+       */
+      bool append(const PriceHistory& other, size_t first, size_t count)
+      {
+         if(other.intraday() != intraday()) return false;
+         return appendBars(count, [&](const Bars& bars)
+         {
+            std::copy_n(other.mDays.data() + first, count, bars.days);
+            if(bars.times != nullptr) std::copy_n(other.mTimes.data() + first, count, bars.times);
+            std::copy_n(other.mOpen.data() + first, count, bars.opens);
+            std::copy_n(other.mHigh.data() + first, count, bars.highs);
+            std::copy_n(other.mLow.data() + first, count, bars.lows);
+            std::copy_n(other.mClose.data() + first, count, bars.closes);
+            std::copy_n(other.mVolume.data() + first, count, bars.volumes);
+            return true;
+         });
+      }
+
+      /*!
+       \brief Appends one intraday bar. Bars must be appended in chronological order.
+       \param time Start of the bar in seconds since 1970-01-01 UTC.
+       \return False, if the history is daily.
+       */
+      bool appendIntraday(int64 time,
+                          double open,
+                          double high,
+                          double low,
+                          double close,
+                          int64 volume)
+      {
+         if(!intraday()) return false;
+         mTimes.push_back(time);
+         appendBar(timeToDays(time), open, high, low, close, volume);
+         return true;
+      }
+
+      /*!
+       \brief Appends one intraday bar. Bars must be appended in chronological order.
+       \return False, if the history is daily.
+       */
+      bool append(const IntradayRecord& record)
+      {
+         return appendIntraday(record.time,
+                               record.open,
+                               record.high,
+                               record.low,
+                               record.close,
+                               record.volume);
+      }
+
+      /*!
+       \brief Replaces the last bar, e.g. with the latest prices of the running day. Ignored for
+       intraday histories.
+       */
+      void replaceLast(const PriceRecord& record)
+      {
+         if(intraday()) return;
+         replaceLast(dateToDays(record.date),
+                     record.open,
+                     record.high,
+                     record.low,
+                     record.close,
+                     record.volume);
+      }
+
+      /*!
+       \brief Replaces the last intraday bar, e.g. with the latest prices of the running minute.
+       Ignored for daily histories.
+       */
+      void replaceLast(const IntradayRecord& record)
+      {
+         if(empty() || !intraday()) return;
+         mTimes.replaceBack(record.time);
+         replaceLast(timeToDays(record.time),
+                     record.open,
+                     record.high,
+                     record.low,
+                     record.close,
+                     record.volume);
+      }
+
+      /*!
+       \brief Inserts the older bars in front of the history.
+       */
+      void prepend(const PriceHistory& older)
+      {
+         mDays.prepend(older.mDays);
+         if(intraday()) mTimes.prepend(older.mTimes);
+         mOpen.prepend(older.mOpen);
+         mHigh.prepend(older.mHigh);
+         mLow.prepend(older.mLow);
+         mClose.prepend(older.mClose);
+         mVolume.prepend(older.mVolume);
+
+         mLowIndex.rebuild(mLow);
+         mHighIndex.rebuild(mHigh);
+         mVolumeIndex.rebuild(mVolume);
+
+         mBaseVersion = nextVersion();
+         mVersion = mBaseVersion;
+      }
+
+   private:
+
+      Column<int32> mDays;
+
+      //! Empty for daily bars.
+      Column<int64> mTimes;
+      Column<double> mOpen;
+      Column<double> mHigh;
+      Column<double> mLow;
+      Column<double> mClose;
+      Column<int64> mVolume;
+
+      BarInterval mInterval;
+
+      //! Appends the bar to all columns except the times.
+      void appendBar(int32 day, double open, double high, double low, double close, int64 volume)
+      {
+         mDays.push_back(day);
+         mOpen.push_back(open);
+         mHigh.push_back(high);
+         mLow.push_back(low);
+         mClose.push_back(close);
+         mVolume.push_back(volume);
+
+         mLowIndex.extend(mLow);
+         mHighIndex.extend(mHigh);
+         mVolumeIndex.extend(mVolume);
+
+         mVersion = nextVersion();
+      }
+
+      void replaceLast(int32 day, double open, double high, double low, double close, int64 volume)
+      {
+         if(empty()) return;
+
+         mDays.replaceBack(day);
+         mOpen.replaceBack(open);
+         mHigh.replaceBack(high);
+         mLow.replaceBack(low);
+         mClose.replaceBack(close);
+         mVolume.replaceBack(volume);
+
+         mLowIndex.truncate(size() - 1);
+         mHighIndex.truncate(size() - 1);
+         mVolumeIndex.truncate(size() - 1);
+         mLowIndex.extend(mLow);
+         mHighIndex.extend(mHigh);
+         mVolumeIndex.extend(mVolume);
+
+         mVersion = nextVersion();
+      }
+
+      //! Keeps the borrowed memory of the columns alive.
+      std::shared_ptr<const void> mStorage;
+
+      RangeIndex<double, std::less<double>> mLowIndex;
+      RangeIndex<double, std::greater<double>> mHighIndex;
+      RangeIndex<int64, std::greater<int64>> mVolumeIndex;
+
+      uint64 mBaseVersion = nextVersion();
+      uint64 mVersion = mBaseVersion;
+
+      static uint64 nextVersion()
+      {
+         static std::atomic<uint64> counter = 0;
+         return ++counter;
+      }
+};
+
+/*!
+ \brief Resolutions of the bars of the price levels.
+ */
+enum class Resolution
+{
+   //! The bars of the history itself, daily or intraday.
+   kBar,
+   kDay,
+   kWeek,
+   kMonth,
+   kQuarter,
+   kYear
+};
+
+/*!
+ \brief The bars of a history aggregated to days (intraday histories only), weeks, months, quarters
+ and years.
+
+ A bar of a level aggregates all bars of the history in its period: the open of the first, the
+ highest high, the lowest low, the close of the last and the sum of the volumes. Its day is the day
+ of its first bar. Weeks start on Monday, periods without bars have no bar. For a daily history,
+ the day level is the history itself.
+
+ update() follows the changes of the history. As long as bars are appended or the last bar is
+ replaced, only the last period of each level and the new bars are aggregated. If older bars were
+ inserted, the levels are rebuilt.
+ */
+class PriceLevels
+{
+   public:
+
+      PriceLevels() = default;
+
+      //! The levels are not copied, the copy is rebuilt on its first update.
+      PriceLevels(const PriceLevels&) {}
+
+      PriceLevels& operator=(const PriceLevels&)
+      {
+         mHistory = nullptr;
+         mVersion = 0;
+         for(Level& level : mLevels) level = Level();
+         return *this;
+      }
+
+      /*!
+       \brief Updates the levels to the history. Must be called before the other methods and after
+       every change of the history.
+       */
+      void update(const PriceHistory& history);
+
+      /*!
+       \brief Returns the bars of the resolution. For Resolution::kBar, this is the history.
+       */
+      const PriceHistory& bars(Resolution resolution) const;
+
+      /*!
+       \brief Returns the index of the first bar of the history, which the bar aggregates.
+       */
+      size_t firstBar(Resolution resolution, size_t index) const;
+
+      /*!
+       \brief Returns the number of bars of the history, which the bar aggregates.
+       */
+      size_t barCount(Resolution resolution, size_t index) const;
+
+      /*!
+       \brief Returns the index of the bar, which contains the bar of the history.
+       */
+      size_t find(Resolution resolution, size_t bar) const;
+
+      /*!
+       \brief Returns the finest resolution, whose bars are on average at least minimumWidth wide.
+       \param barWidth Width of a bar of the history.
+       \return Resolution::kYear, if even the yearly bars are narrower.
+       */
+      Resolution select(double barWidth, double minimumWidth) const;
+
+   private:
+
+      struct Level
+      {
+         PriceHistory bars;
+
+         //! Index of the first bar of the history of each bar.
+         std::vector<size_t> firstBars;
+      };
+
+      //! The history of the last update.
+      const PriceHistory* mHistory = nullptr;
+
+      uint64 mVersion = 0;
+
+      uint64 mBaseVersion = 0;
+
+      //! Daily, weekly, monthly, quarterly and yearly bars.
+      Level mLevels[5];
+
+      const Level& level(Resolution resolution) const
+      {
+         return mLevels[(int)resolution - 1];
+      }
+
+      /*!
+       \brief Returns true, if the bars of the resolution are those of the history.
+       */
+      bool isHistory(Resolution resolution) const
+      {
+         return resolution == Resolution::kBar ||
+                (resolution == Resolution::kDay && !mHistory->intraday());
+      }
+
+      /*!
+       \brief Aggregates the bars of the history from the index on into the level.
+       \param replace If true, the first period replaces the last bar of the level.
+       */
+      void aggregate(Resolution resolution, size_t index, bool replace);
+};
+
+class StockDatabase;
+class StockCache;
+
+class Stock
+{
+   public:
+
+      jm::String name;
+      jm::String symbol;
+      jm::String currency;
+
+      //! The loaded part of the price history, oldest first. If the stock is paged, older bars may
+      //! exist in the database. Daily or intraday, see PriceHistory::interval().
+      PriceHistory priceHistory;
+
+      //! Indicator series computed from the price history, shared by all charts of the stock.
+      //! Derived data, so it can be filled on demand also for shared (const) stocks. Not thread
+      //! safe, like the levels.
+      mutable indicators::IndicatorCache indicatorCache;
+
+      //! Weekly, monthly, quarterly and yearly bars of the price history.
+      mutable PriceLevels priceLevels;
+
+      //! Revision of the prices in the database, when the stock was loaded (see stocks.revision).
+      int64 revision = 0;
+
+      /*!
+       \brief Returns true, if the database may contain bars older than the first loaded one.
+       */
+      bool hasOlder() const
+      {
+         return mSource != nullptr && mHasOlder;
+      }
+
+      /*!
+       \brief Loads up to count bars older than the first loaded bar from the database and inserts
+       them in front of the history.
+       \return The number of bars inserted. All indices into the history shift by this number.
+       */
+      size_t loadOlder(size_t count);
+
+      /*!
+       \brief Returns the minimum price in the given time range
+       \param start First day of range (including)
+       \param end Last day of range (including)
+       */
+      double minPrice(size_t start,size_t end) const
+      {
+         if(priceHistory.size()==0)return 0;
+         return priceHistory.minLow(start,end);
+      }
+
+      /*!
+       \brief Returns the maximum price in the given time range
+       \param start First day of range (including)
+       \param end Last day of range (including)
+       */
+      double maxPrice(size_t start,size_t end) const
+      {
+         if(priceHistory.size()==0)return 0;
+         return priceHistory.maxHigh(start,end);
+      }
+
+      /*!
+       \brief Returns the maximum volume in the given time range
+       \param start First day of range (including)
+       \param end Last day of range (including)
+       */
+      int64 maxVolume(size_t start,size_t end) const
+      {
+         if(priceHistory.size()==0)return 0;
+         return priceHistory.maxVolume(start,end);
+      }
+
+   private:
+
+      friend class StockDatabase;
+
+      //! The database the history is paged from.
+      StockDatabase* mSource = nullptr;
+
+      //! True, if the last page request was complete.
+      bool mHasOlder = false;
+
+};
+
+/*!
+ \brief Connection settings of the stock database, applied as pragmas when the database is opened.
+ */
+struct DatabaseOptions
+{
+   //! Journal mode ("WAL", "DELETE", "TRUNCATE", "MEMORY", ...).
+   jm::String journalMode = "WAL";
+
+   //! Page cache size. Positive values are pages, negative values are KiB (SQLite convention).
+   int cacheSize = -65536;
+
+   //! Maximum number of bytes of the database file which are memory mapped. 0 disables mmap.
+   int64 mmapSize = 256ll * 1024 * 1024;
+
+   //! Synchronous mode: 0 = OFF, 1 = NORMAL, 2 = FULL, 3 = EXTRA.
+   int synchronous = 1;
+
+   //! Milliseconds to wait for a lock held by another connection (e.g. the ingest writer).
+   int busyTimeout = 5000;
+
+   //! Directory of the memory mapped price snapshots. Empty disables snapshots.
+   jm::String snapshotDirectory;
+
+   //! If true, the checksum of the column data is verified when a snapshot is mapped.
+   bool verifySnapshots = true;
+
+   //! Cache of the shared stocks (see StockDatabase::sharedStock()). Connections with the same
+   //! cache share their stocks. If null, the connection creates its own cache.
+   std::shared_ptr<StockCache> stockCache;
+
+   //! Memory budget in bytes of the cache created by the connection.
+   size_t stockCacheBudget = 512ull * 1024 * 1024;
+
+   //! If true, initSchema() converts the prices into compressed chunks (see compressPrices()).
+   bool compressPrices = false;
+};
+
+/*!
+ \brief The stock database stores and manages the prices of the stocks in a local database.
+
+ Every SQL statement is prepared once and cached for the lifetime of the connection. Stock ids are
+ cached too, so repeated symbol lookups do not touch SQLite.
+
+ If a snapshot directory is configured, the price history of each stock is additionally kept in a
+ binary columnar file, which is memory mapped instead of queried. Each stock has a revision, which
+ increases with every change of its prices. A snapshot of an outdated revision is rebuilt from
+ SQLite the next time the stock is loaded, snapshots of unchanged stocks are left untouched.
+
+ The prices are stored either with one row per bar or, after compressPrices(), in compressed chunks
+ of up to chunks::kChunkSize bars (see PriceChunks.h). A chunk is a BLOB of a few pages, so a full
+ history is read with few page reads and decoded directly into the columns of the history.
+ */
+class StockDatabase 
+{
+   public:
+
+      /*!
+       \brief Construktor
+       \param dbFile Path of the database file.
+       \param options Connection settings.
+       */
+      StockDatabase(const jm::String& dbFile, const DatabaseOptions& options = DatabaseOptions());
+
+      /*!
+       \brief Destruktor
+       */
+      ~StockDatabase();
+
+      /*!
+       \brief Initializes the stock database.
+
+       Creates the tables of the current schema version or migrates an existing database file in
+       place. The version is kept in "PRAGMA user_version":
+        - 0/1: prices with rowid, TEXT dates and no index on (stock_id, date)
+        - 2: prices clustered on (stock_id, day) WITHOUT ROWID, day = days since 1970-01-01
+        - 3: stocks.revision, increased with every change of the prices of the stock
+        - 4: intraday_prices clustered on (stock_id, interval, time) WITHOUT ROWID, interval is the
+             duration of the bars and time their start, both in seconds (since 1970-01-01 UTC)
+        - 5: price_chunks with the compressed bars and settings, whose "price_storage" is "chunks"
+             once the prices are compressed
+       */
+      bool initSchema();
+
+      /*!
+       \brief Adds an empty stock to the database.
+       */
+      int addStock(const jm::String& symbol, 
+                   const jm::String& name , 
+                   const jm::String& currency);
+      
+      /*!
+       \brief Inserts a single price record for the stock. An existing record of the same day is
+       replaced.
+       */
+      bool insertPrice(const jm::String& symbol, const PriceRecord& record);
+
+      /*!
+       \brief Inserts a batch of price records for the stock. Existing records of the same days are
+       replaced.
+
+       The stock id is resolved once and all rows are written with one prepared statement inside a
+       single transaction. If any row fails, the whole batch is rolled back. Within a transaction
+       of the caller, the batch is written in a savepoint, so only the batch is rolled back.
+
+       The shared stock of the symbol is invalidated after the commit. Within a transaction of the
+       caller, the caller must invalidate it with stockCache() after its own commit.
+
+       \return True, if all records were written.
+       */
+      bool insertPrices(const jm::String& symbol, std::span<const PriceRecord> records);
+
+      /*!
+       \brief Inserts a batch of intraday bars for the stock. Existing bars of the same interval and
+       start time are replaced.
+
+       As for insertPrices(), all rows are written with one prepared statement inside a single
+       transaction. The daily prices and their snapshot are not affected.
+
+       \return True, if all records were written.
+       */
+      bool insertIntradayPrices(const jm::String& symbol,
+                                BarInterval interval,
+                                std::span<const IntradayRecord> records);
+
+      /*!
+       \brief Returns the price records of the stock within the date range, oldest first.
+       \param from First day of range (including)
+       \param to Last day of range (including)
+       */
+      PriceHistory getPrices(const jm::String& symbol,
+                             const jm::Date& from,
+                             const jm::Date& to);
+
+      /*!
+       \brief Returns the last count price records of the stock before the date, oldest first.
+       \param before First day not included in the result.
+       */
+      PriceHistory getPricesBefore(const jm::String& symbol,
+                                   const jm::Date& before,
+                                   size_t count);
+
+      /*!
+       \brief Returns the intraday bars of the stock within the time range, oldest first.
+       \param from First start time of range in seconds since 1970-01-01 UTC (including)
+       \param to Last start time of range in seconds since 1970-01-01 UTC (including)
+       */
+      PriceHistory getIntradayPrices(const jm::String& symbol,
+                                     BarInterval interval,
+                                     int64 from,
+                                     int64 to);
+
+      /*!
+       \brief Returns the last count intraday bars of the stock before the time, oldest first.
+       \param before First start time not included in the result.
+       */
+      PriceHistory getIntradayPricesBefore(const jm::String& symbol,
+                                           BarInterval interval,
+                                           int64 before,
+                                           size_t count);
+
+      /*!
+       \brief Returns the stock, if it exists in the database.
+
+       \param bars If 0, the full history is loaded. Otherwise only the latest bars are loaded and
+       older ones can be paged in with Stock::loadOlder(). The database must outlive the stock. If
+       snapshots are enabled, the full history is mapped regardless of this parameter.
+       \return The stock or nullptr, if the stock does not exist in the local database.
+       */
+      Stock* stock(const jm::String& symbol, size_t bars = 0);
+
+      /*!
+       \brief Returns the stock with the bars of the interval, if it exists in the database.
+
+       Intraday histories are paged like daily ones, but never kept in snapshots. For
+       BarInterval::kDay, this is the same as stock(symbol, bars).
+       \return The stock or nullptr, if the stock does not exist in the local database.
+       */
+      Stock* stock(const jm::String& symbol, BarInterval interval, size_t bars = 0);
+
+      /*!
+       \brief Returns the complete stock from the stock cache, loading it only if no one uses it
+       yet.
+
+       All callers get the same instance, so the history is kept once, however many charts or
+       lists show it. The stock is immutable and never paged. A change of its prices, also through
+       another connection or process, replaces it in the cache by a new instance at the next
+       request: each request compares the revision of the cached stock with stocks.revision.
+       \return The stock or nullptr, if the stock does not exist in the local database.
+       */
+      std::shared_ptr<const Stock> sharedStock(const jm::String& symbol);
+
+      /*!
+       \brief Returns the cache of the shared stocks.
+       */
+      StockCache& stockCache();
+
+      /*!
+       \brief Converts the prices of all stocks from one row per bar into compressed chunks.
+
+       The conversion runs in one transaction, afterwards the file is vacuumed. The database stays
+       compressed, also for connections which do not set DatabaseOptions::compressPrices.
+       \return True, if the prices are compressed.
+       */
+      bool compressPrices();
+
+      /*!
+       \brief Returns true, if the prices are stored in compressed chunks, also if another
+       connection compressed them.
+       */
+      bool compressed();
+
+      /*!
+       \brief Returns the symbols of all stocks, ordered alphabetically.
+       */
+      std::vector<jm::String> symbols();
+
+      /*!
+       \brief Rebuilds the snapshots of all stocks whose prices changed since their snapshot was
+       written.
+       \return The number of rebuilt snapshots.
+       */
+      size_t updateSnapshots();
+      
+   private:
+
+      /*!
+       \brief Resets a cached statement when leaving the scope.
+
+       A stepped but not reset statement keeps its read transaction open, which would block writers
+       and checkpoints.
+       */
+      struct ScopedStatement
+      {
+         sqlite3_stmt* stmt;
+
+         ScopedStatement(sqlite3_stmt* statement): stmt(statement) {}
+
+         ~ScopedStatement()
+         {
+            if(stmt) sqlite3_reset(stmt);
+         }
+
+         operator sqlite3_stmt*() const { return stmt; }
+      };
+
+      sqlite3* mDb;
+
+      //! Prepared statements, keyed by their SQL text (string literals only).
+      std::unordered_map<const char*, sqlite3_stmt*> mStatements;
+
+      //! Cached stock ids, keyed by symbol.
+      std::unordered_map<std::string, int> mStockIds;
+
+      //! Directory of the snapshots, empty if disabled.
+      std::string mSnapshotDirectory;
+
+      //! Verify the checksum of mapped snapshots.
+      bool mVerifySnapshots = true;
+
+      //! Cache of the shared stocks, maybe shared with other connections.
+      std::shared_ptr<StockCache> mStockCache;
+
+      //! True, if the prices are stored in compressed chunks, as last seen by chunkStorage().
+      bool mCompressed = false;
+
+      //! PRAGMA data_version, when chunkStorage() last read the storage setting.
+      int64 mDataVersion = -1;
+
+      //! Compress the prices in initSchema().
+      bool mCompressPrices = false;
+
+      /*!
+       \brief Applies the connection settings.
+       */
+      void applyOptions(const DatabaseOptions& options);
+
+      /*!
+       \brief Returns true, if the prices are stored in compressed chunks. Reads the setting again,
+       if another connection committed since the last call, so a conversion by another connection
+       is noticed. Writes check it under the write lock in beginWrite(). Reads of rows check it
+       again afterwards and read the chunks instead, if the rows were converted in between.
+       */
+      bool chunkStorage();
+
+      /*!
+       \brief Returns the cached prepared statement for the SQL text, preparing it on first use.
+
+       The statement is reset and its bindings are cleared.
+       \param sql The SQL text. Must be a string literal, because the pointer is the cache key.
+       \return The statement or nullptr, if the statement could not be prepared.
+       */
+      sqlite3_stmt* statement(const char* sql);
+
+      /*!
+       \brief Executes the SQL script.
+       */
+      bool exec(const char* sql);
+
+      /*!
+       \brief Begins a write transaction or, if the caller already opened one, a savepoint.
+       \param ownTransaction Set to true, if the transaction was opened.
+       */
+      bool beginWrite(bool& ownTransaction);
+
+      /*!
+       \brief Commits the write transaction or releases the savepoint on success, otherwise rolls
+       back to the beginWrite().
+       \return True, if the write succeeded and was committed.
+       */
+      bool endWrite(bool ownTransaction, bool success);
+
+      /*!
+       \brief Returns the schema version of the database file.
+       */
+      int schemaVersion();
+
+      /*!
+       \brief Migrates the prices table from schema version 1 to 2.
+       */
+      bool migrateToVersion2();
+
+      /*!
+       \brief Adds the price revision to the stocks table (schema version 3).
+       */
+      bool migrateToVersion3();
+
+      /*!
+       \brief Returns the path of the snapshot file of the stock.
+       */
+      std::string snapshotPath(int stockId) const;
+
+      /*!
+       \brief Maps the snapshot of the stock, if it exists, is valid and has the revision.
+       */
+      bool loadSnapshot(int stockId, int64 revision, PriceHistory& history);
+
+      /*!
+       \brief Writes the snapshot of the stock.
+       */
+      bool writeSnapshot(int stockId, int64 revision, const PriceHistory& history);
+
+      /*!
+       \brief Returns the revision of the snapshot of the stock or -1, if there is no valid one.
+       */
+      int64 snapshotRevision(int stockId) const;
+
+      int getStockId(const jm::String& symbol);
+
+      bool getStockData(int stockId,
+                        jm::String& name,
+                        jm::String& currency,
+                        int64& revision);
+
+      //! Returns the revision of the prices of the stock or -1, if it does not exist.
+      int64 getRevision(int stockId);
+
+      PriceHistory getPrices(int stockId);
+
+      PriceHistory getPrices(int stockId, int32 fromDay, int32 toDay);
+
+      PriceHistory getPricesBefore(int stockId, int32 beforeDay, size_t count);
+
+      PriceHistory getIntradayPrices(int stockId, BarInterval interval, int64 from, int64 to);
+
+      PriceHistory getIntradayPricesBefore(int stockId,
+                                           BarInterval interval,
+                                           int64 before,
+                                           size_t count);
+
+      bool insertPriceRows(int stockId, std::span<const PriceRecord> records);
+
+      bool insertIntradayRows(int stockId,
+                              BarInterval interval,
+                              std::span<const IntradayRecord> records);
+
+      /*!
+       \brief Merges the bars into the chunks of the stock. Existing bars with the same time are
+       replaced. The chunks from the first one touched by the bars to the last one are rewritten,
+       so all chunks but the last stay full.
+       */
+      bool writeChunks(int stockId, BarInterval interval, const PriceHistory& bars);
+
+      /*!
+       \brief Returns the bars of the chunks within the time range (in seconds, including).
+       */
+      PriceHistory readChunks(int stockId, BarInterval interval, int64 from, int64 to);
+
+      /*!
+       \brief Returns the last count bars of the chunks before the time (in seconds).
+       */
+      PriceHistory readChunksBefore(int stockId, BarInterval interval, int64 before, size_t count);
+
+      /*!
+       \brief Appends the price records of the executed statement to the history.
+       */
+      void readPrices(sqlite3_stmt* stmt, PriceHistory& results);
+
+      /*!
+       \brief Appends the intraday bars of the executed statement to the history.
+       */
+      void readIntradayPrices(sqlite3_stmt* stmt, PriceHistory& results);
+};
+
+#endif
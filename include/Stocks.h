@@ -17,118 +17,163 @@
 #ifndef StockMainWindow_h
 #define StockMainWindow_h
 
-#include <sqlite3.h>
+#include <mutex>
 
-#include "core/Core.h"
+#include "DisplayList.h"
+#include "StockData.h"
 #include "Nuitk.h"
 
+class CountingPainter;
+
 /*!
- \brief The price record for one period (usually a day).
+ \brief Represents a chart line.
  */
-struct PriceRecord
+class DllExport Chart
 {
-   jm::Date date;
-   double open;
-   double high;
-   double low;
-   double close;
-   int volume;
+
 };
 
-class Stock
+/*!
+ \brief The trading chart.
+
+  - The horizontal axis is the time line
+  - The vertical axis depends on the shown chart
+  - The trading chart may contain multiple subcharts. 
+  - Eachs subchart may contain multiple overlays
+ */
+class DllExport TradingChart: public nui::Canvas
 {
    public:
 
-      jm::String name;
-      jm::String symbol;
-      jm::String currency;
+      TradingChart();
+
+      //! Number of bars loaded with each page of a paged stock.
+      static const int64 kPageSize = 250;
 
-      std::vector<PriceRecord> priceHistory;
+      //! Minimum width of a bar in pixel. Narrower bars are drawn as daily, weekly, monthly... bars.
+      static constexpr double kMinimumBarWidth = 3.0;
+
+      //! Bars narrower than this (in pixel) are aggregated per pixel column.
+      static constexpr double kAggregationWidth = 1.0;
 
       /*!
-       \brief Returns the minimum price in the given time range
-       \param start First day of range (including)
-       \param end Last day of range (including)
+       \brief Shows the stock, which stays owned by the caller and must outlive the chart. Older
+       pages of a paged stock are loaded on demand.
        */
-      double minPrice(size_t start,size_t end) const
-      {
-         if(priceHistory.size()==0)return 0;
+      void setStock(Stock* stock);
 
-         double price = priceHistory[start].low;
-         for(size_t index=start+1;index <= end; index++)
-         {
-            double low = priceHistory[index].low;
-            if(low < price ) price = low;
-         }
-         return price;
-      }
+      /*!
+       \brief Shows a shared stock, e.g. from StockDatabase::sharedStock(). The chart keeps it
+       alive.
+       */
+      void setStock(std::shared_ptr<const Stock> stock);
 
       /*!
-       \brief Returns the maximum price in the given time range
-       \param start First day of range (including)
-       \param end Last day of range (including)
+       \brief Shows the latest bars. Older pages of a paged stock are loaded as needed.
        */
-      double maxPrice(size_t start,size_t end) const
-      {
-         if(priceHistory.size()==0)return 0;
-         
-         double price = priceHistory[start].high;
-         for(size_t index=start+1;index <= end; index++)
-         {
-            double high = priceHistory[index].high;
-            if(high > price ) price = high;
-         }
-         return price;
-      }
+      void showBars(int64 count);
 
       /*!
-       \brief Returns the volume in the given time range
-       \param start First day of range (including)
-       \param end Last day of range (including)
+       \brief Paints the chart into the display list instead of the canvas, e.g. for benchmarks.
+       The cached layers are used and updated as in a painted frame.
+       \param width Width of the chart in pixel.
+       \param height Height of the chart in pixel.
        */
-      int maxVolume(size_t start,size_t end) const
-      {
-         if(priceHistory.size()==0)return 0;
-         
-         int volume = priceHistory[start].volume;
-         for(size_t index=start+1;index <= end; index++)
-         {
-            int vol = priceHistory[index].volume;
-            if(volume > vol ) volume = vol;
-         }
-         return volume;
-      }
+      void record(DisplayList& list, double width, double height);
 
-};
+      /*!
+       \brief Returns the number of painter calls of the last painted frame.
+       */
+      size_t painterCalls() const;
 
-/*!
- \brief Represents a chart line.
- */
-class DllExport Chart
-{
+      /*!
+       \brief Shows or hides the timings of the paint phases on the chart. Has only an effect, if
+       the instrumentation is compiled in (see Profiler.h).
+       */
+      void setProfileHud(bool visible);
 
-};
+      /*!
+       \brief Shows the status line below the title, e.g. the progress of an import. Can be called
+       from any thread. As long as the status is busy, each paint schedules the next one, so the UI
+       thread takes the latest status over without an event.
+       \param busy False for the last status. The UI thread calls the handler of setOnStatusDone()
+       with the next paint.
+       */
+      void postStatus(const jm::String& status, bool busy);
 
-/*!
- \brief The trading chart.
+      /*!
+       \brief Sets the handler, which is called once on the UI thread after the last status was
+       posted, e.g. to reload the imported stock.
+       */
+      void setOnStatusDone(std::function<void()> handler);
 
-  - The horizontal axis is the time line
-  - The vertical axis depends on the shown chart
-  - The trading chart may contain multiple subcharts. 
-  - Eachs subchart may contain multiple overlays
- */
-class DllExport TradingChart: public nui::Canvas
-{
-   public:
+   private:
 
-      TradingChart();
+      /*!
+       \brief A bar as drawn, either one bar of the price level or the bars of one pixel column.
 
-      void setStock(const Stock* stock);
+       For a pixel column, open and close are those of its first and last bar, high and low the
+       extremes of all its bars (M4 aggregation). The close line passes the first close, the
+       extremes of the closes and the last close, so it covers the same pixels as the line through
+       all bars.
+       */
+      struct DrawnBar
+      {
+         double x;
+         double width;
+
+         //! Positions of the first and the last bar of a pixel column.
+         double firstX;
+         double lastX;
+
+         double open;
+         double high;
+         double low;
+         double close;
+         double firstClose;
+         double minClose;
+         double maxClose;
+         int64 volume;
+      };
 
-   private:
+      /*!
+       \brief The state, which the cached layers were painted for.
+       */
+      struct LayerState
+      {
+         const Stock* stock = nullptr;
+         int64 first = 0;
+         int64 last = 0;
+
+         //! The visible span, which sets the x-scale also if first and last are clamped.
+         int64 span = 0;
+         Resolution resolution = Resolution::kBar;
+         double width = 0.0;
+         double height = 0.0;
+         double low = 0.0;
+         double high = 0.0;
+         uint64 baseVersion = 0;
+         uint64 version = 0;
+
+         /*!
+          \brief Returns true, if the grid, the axes and their labels are the same for both states.
+          */
+         bool sameGrid(const LayerState& other) const
+         {
+            return stock == other.stock && first == other.first && last == other.last &&
+                   span == other.span && resolution == other.resolution &&
+                   width == other.width && height == other.height && low == other.low &&
+                   high == other.high && baseVersion == other.baseVersion;
+         }
+
+         bool operator==(const LayerState& other) const = default;
+      };
 
       //! The main stock to display.
-      const Stock* mStock = nullptr;
+      std::shared_ptr<const Stock> mStock;
+
+      //! The stock, if it was set by the caller without sharing. Older pages are loaded on demand.
+      Stock* mPagedStock = nullptr;
 
       //! The first visible tick
       int64 mFirst;
@@ -153,67 +198,67 @@ class DllExport TradingChart: public nui::Canvas
       //! Positive offseat means moving the "paper" to the right
       jm::Point mOffset;
 
+      //! Drag distance in pixel, which was not yet converted into whole bars.
+      double mPanRemainder = 0.0;
+
       //! Area of the chart
       jm::Rect chartArea;
 
-      //! Paints the chart
-      void paint(nui::Painter* painter);
+      //! The bars of the last paint, kept to reuse the memory.
+      std::vector<DrawnBar> mDrawnBars;
 
+      //! Background, grid, axes and title, as painted for mLayerState.
+      DisplayList mGridLayer;
 
-};
+      //! Volume, line and candles, as painted for mLayerState.
+      DisplayList mSeriesLayer;
 
-/*!
- \brief The stock database stores and manages the prices of the stocks in a local database.
+      LayerState mLayerState;
 
- */
-class StockDatabase 
-{
-   public:
+      //! True, if the timings of the paint phases are shown.
+      bool mProfileHud = false;
 
-      /*!
-       \brief Construktor
-       */
-      StockDatabase(const jm::String& dbFile);
+      //! Number of painter calls of the last frame.
+      size_t mPainterCalls = 0;
 
-      /*!
-       \brief Destruktor
-       */
-      ~StockDatabase();
+      //! Guards the posted status, which is written by other threads.
+      std::mutex mStatusMutex;
+
+      //! The status line, shown if mStatusPosted is true.
+      jm::String mPostedStatus;
+      bool mStatusPosted = false;
+      bool mStatusBusy = false;
+
+      //! Called on the UI thread after the last status, only used by the UI thread.
+      std::function<void()> mOnStatusDone;
+
+      //! Paints the chart and counts the painter calls.
+      void paint(nui::Painter* target);
+
+      //! Paints the chart into the bounds.
+      void paint(CountingPainter* painter, jm::Rect bounds);
 
       /*!
-       \brief Initializes the stock database.
+       \brief Loads older pages of the stock until at least first bars exist left of the visible
+       range or the history is complete. Adjusts the visible range to the shifted indices.
        */
-      bool initSchema();
+      void ensureLoaded(int64 first);
 
       /*!
-       \brief Adds an empty stock to the database.
+       \brief Shows the stock with the latest bars.
        */
-      int addStock(const jm::String& symbol, 
-                   const jm::String& name , 
-                   const jm::String& currency);
-      
-      bool insertPrice(const jm::String& symbol, const PriceRecord& record);
+      void show(std::shared_ptr<const Stock> stock);
 
       /*!
-       \brief Returns the stock, if it exists in the database.
-
-       \return The stock or nullptr, if the stock does not exist in the local database.
+       \brief Moves the visible range by the number of bars. Negative values move into the past.
        */
-      Stock* stock(const jm::String& symbol);
-      
-   private:
+      void scrollBy(int64 bars);
 
-      sqlite3* mDb;
 
-      int getStockId(const jm::String& symbol);
-
-      bool getStockData(const jm::String& symbol,
-                        jm::String& name,
-                        jm::String& currency);
-
-      std::vector<PriceRecord> getPrices(const jm::String& symbol);
 };
 
+class IngestPipeline;
+
 /*!
  \brief This is the main window of the application
  */
@@ -234,12 +279,23 @@ class DllExport MainWindow: public nui::ApplicationWindow
 
    private:
 
+      /*!
+       \brief Loads the stock of the chart again from the database and shows it.
+       */
+      void loadStock();
+
       //! The local stock database, it contains the market data.
       StockDatabase* mDb;
 
       // The trading chart widget
       TradingChart* mChart;
 
+      //! The stock of the chart, loaded in pages. The chart loads older pages on demand.
+      std::unique_ptr<Stock> mStock;
+
+      //! Background import of the prices, if started. Closing the window cancels it.
+      IngestPipeline* mIngest = nullptr;
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name:        ThreadPool.h
+// Application: Stock Analyser
+// Purpose:     Work stealing thread pool for data parallel loops
+//
+// Author:      Uwe Runtemund (2025-today)
+// Modified by:
+// Created:     17.10.2026
+//
+// Copyright:   (c) 2025 Jameo Software, Germany. https://jameo.de
+//
+//              All rights reserved. The methods and techniques described herein are considered
+//              trade secrets and/or confidential. Reproduction or distribution, in whole or in
+//              part, is forbidden except by express written permission of Jameo.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StockThreadPool_h
+#define StockThreadPool_h
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/Core.h"
+
+/*!
+ \brief A fixed set of worker threads, which run parallel loops.
+
+ parallelFor() splits the index range into one contiguous range per worker. A worker takes the
+ indices of its own range from the front. If its range is empty, it steals the back half of the
+ largest remaining range of another worker. So workers, which get cheap items (e.g. stocks with a
+ short history), help the others, and contiguous indices stay on one worker as long as possible.
+
+ Each task gets the index of the worker it runs on, so per worker state (e.g. a database
+ connection or scratch buffers) can be kept in a vector of size() entries without locking.
+ */
+class ThreadPool
+{
+   public:
+
+      /*!
+       \brief Receives the index of the item and the index of the worker.
+       */
+      typedef std::function<void(size_t index, size_t worker)> Task;
+
+      /*!
+       \brief Constructor
+       \param threads Number of workers. 0 uses one worker per hardware thread.
+       */
+      explicit ThreadPool(size_t threads = 0);
+
+      /*!
+       \brief Destructor. Waits for the running loop and stops the workers.
+       */
+      ~ThreadPool();
+
+      /*!
+       \brief Returns the number of workers.
+       */
+      size_t size() const;
+
+      /*!
+       \brief Runs the task for all indices from 0 to count (excluding) and returns, when all are
+       done. Must not be called from a task.
+       */
+      void parallelFor(size_t count, const Task& task);
+
+   private:
+
+      /*!
+       \brief The remaining indices of a worker. Aligned, so workers do not share cache lines.
+       */
+      struct alignas(64) Range
+      {
+         std::mutex mutex;
+         size_t begin = 0;
+         size_t end = 0;
+      };
+
+      std::vector<std::thread> mThreads;
+
+      std::unique_ptr<Range[]> mRanges;
+
+      std::mutex mMutex;
+
+      std::condition_variable mStart;
+
+      std::condition_variable mDone;
+
+      //! Task of the running loop.
+      const Task* mTask = nullptr;
+
+      //! Increased with every loop, so the workers notice a new one.
+      uint64 mGeneration = 0;
+
+      //! Number of workers, which did not finish the running loop.
+      size_t mBusy = 0;
+
+      bool mStop = false;
+
+      void run(size_t worker);
+
+      /*!
+       \brief Takes the next index of the worker's range or steals from another worker.
+       \return False, if all ranges are empty.
+       */
+      bool next(size_t worker, size_t& index);
+};
+
+#endif
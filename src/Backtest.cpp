@@ -0,0 +1,291 @@
+//
+//  Backtest.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include "Backtest.h"
+#include "Pipeline.h"
+
+namespace backtest
+{
+   //! Returns the parameter as period.
+   static int period(double parameter)
+   {
+      return std::max((int)std::lround(parameter), 1);
+   }
+
+   //! Position of a crossover rule. NaN values (warm-up) give no position.
+   static double crossoverPosition(double fast, double slow, bool allowShort)
+   {
+      if(fast > slow) return 1.0;
+      if(fast < slow && allowShort) return -1.0;
+      return 0.0;
+   }
+
+   void MacdCrossover::positions(const PriceHistory& history,
+                                 std::span<const double> parameters,
+                                 Scratch& scratch,
+                                 std::span<double> positions) const
+   {
+      size_t size = history.size();
+      std::span<double> line = scratch.buffer(0, size);
+      std::span<double> signal = scratch.buffer(1, size);
+
+      pipeline::macd(period(parameters[0]), period(parameters[1]), period(parameters[2]))
+         .run<3, 4>(history, line, signal);
+
+      for(size_t index = 0; index < size; index++)
+      {
+         positions[index] = crossoverPosition(line[index], signal[index], mAllowShort);
+      }
+   }
+
+   void SmaCrossover::positions(const PriceHistory& history,
+                                std::span<const double> parameters,
+                                Scratch& scratch,
+                                std::span<double> positions) const
+   {
+      size_t size = history.size();
+      std::span<double> fast = scratch.buffer(0, size);
+      std::span<double> slow = scratch.buffer(1, size);
+
+      pipeline::make(pipeline::Close(),
+                     pipeline::Sma<0>(period(parameters[0])),
+                     pipeline::Sma<0>(period(parameters[1])))
+         .run<1, 2>(history, fast, slow);
+
+      for(size_t index = 0; index < size; index++)
+      {
+         positions[index] = crossoverPosition(fast[index], slow[index], mAllowShort);
+      }
+   }
+
+   void ParameterGrid::add(double first, double last, double step)
+   {
+      std::vector<double> values;
+      if(step > 0.0 && last >= first)
+      {
+         // Computed from the count, so rounding errors of the step do not add up or drop the last.
+         size_t count = (size_t)std::floor((last - first) / step + 1e-9) + 1;
+         for(size_t index = 0; index < count; index++) values.push_back(first + index * step);
+      }
+      else values.push_back(first);
+      add(std::move(values));
+   }
+
+   void ParameterGrid::add(std::vector<double> values)
+   {
+      mValues.push_back(std::move(values));
+   }
+
+   size_t ParameterGrid::dimensions() const
+   {
+      return mValues.size();
+   }
+
+   size_t ParameterGrid::size() const
+   {
+      size_t size = 1;
+      for(const std::vector<double>& values : mValues) size *= values.size();
+      return size;
+   }
+
+   void ParameterGrid::combination(size_t index, std::span<double> values) const
+   {
+      for(size_t dimension = mValues.size(); dimension-- > 0;)
+      {
+         const std::vector<double>& axis = mValues[dimension];
+         values[dimension] = axis[index % axis.size()];
+         index /= axis.size();
+      }
+   }
+
+   Engine::Engine(const Options& options):
+      mOptions(options),
+      mPool(options.threads),
+      mScratch(mPool.size())
+   {
+   }
+
+   size_t Engine::workers() const
+   {
+      return mPool.size();
+   }
+
+   Statistics Engine::run(const PriceHistory& history,
+                          const Rule& rule,
+                          std::span<const double> parameters,
+                          EquityCurve* curve)
+   {
+      if(parameters.size() != rule.parameters()) return Statistics();
+      return simulate(history, rule, parameters, mScratch[0], curve);
+   }
+
+   std::vector<SweepResult> Engine::sweep(std::span<const Stock* const> stocks,
+                                          const Rule& rule,
+                                          const ParameterGrid& grid)
+   {
+      std::vector<SweepResult> results;
+      if(grid.dimensions() != rule.parameters())
+      {
+         std::cerr << "The parameter grid has " << grid.dimensions() << " parameters, the rule "
+                   << rule.parameters() << std::endl;
+         return results;
+      }
+
+      size_t combinations = grid.size();
+      results.resize(stocks.size() * combinations);
+
+      // Every run writes its own result, so no locking is needed.
+      mPool.parallelFor(results.size(), [&](size_t index, size_t worker)
+      {
+         Scratch& scratch = mScratch[worker];
+         size_t stock = index / combinations;
+         size_t combination = index % combinations;
+
+         scratch.mParameters.resize(grid.dimensions());
+         grid.combination(combination, scratch.mParameters);
+
+         results[index] = {stock,
+                           combination,
+                           simulate(stocks[stock]->priceHistory,
+                                    rule,
+                                    scratch.mParameters,
+                                    scratch,
+                                    nullptr)};
+      });
+
+      return results;
+   }
+
+   Statistics Engine::simulate(const PriceHistory& history,
+                               const Rule& rule,
+                               std::span<const double> parameters,
+                               Scratch& scratch,
+                               EquityCurve* curve) const
+   {
+      Statistics statistics;
+      size_t size = history.size();
+      if(curve != nullptr)
+      {
+         curve->equity.assign(size, 1.0);
+         curve->drawdown.assign(size, 0.0);
+      }
+      if(size < 2) return statistics;
+
+      // The returns only depend on the stock, so they are kept for the next combination.
+      if(scratch.mReturnsOf != &history || scratch.mReturnsVersion != history.version())
+      {
+         const Column<double>& closes = history.closes();
+         scratch.mReturns.resize(size);
+         scratch.mReturns[0] = 0.0;
+         for(size_t index = 1; index < size; index++)
+         {
+            scratch.mReturns[index] = closes[index] / closes[index - 1] - 1.0;
+         }
+         scratch.mReturnsOf = &history;
+         scratch.mReturnsVersion = history.version();
+      }
+
+      scratch.mPositions.resize(size);
+      std::span<double> positions(scratch.mPositions.data(), size);
+      rule.positions(history, parameters, scratch, positions);
+
+      const double* returns = scratch.mReturns.data();
+      double commission = mOptions.commission;
+
+      double equity = 1.0;
+      double peak = 1.0;
+      double held = 0.0;
+      double tradeStart = 1.0;
+      double sum = 0.0;
+      double sumOfSquares = 0.0;
+      double gains = 0.0;
+      double losses = 0.0;
+      size_t wins = 0;
+      size_t exposed = 0;
+
+      // Bar index gains the return of the position decided at the close of the bar before.
+      for(size_t index = 1; index < size; index++)
+      {
+         double previous = equity;
+         double position = positions[index - 1];
+
+         if(position != held)
+         {
+            equity *= 1.0 - std::abs(position - held) * commission;
+
+            // The costs of a change belong to the trade, which ends with it.
+            if(held != 0.0 && (position > 0.0) != (held > 0.0))
+            {
+               double trade = equity / tradeStart - 1.0;
+               statistics.trades++;
+               if(trade > 0.0)
+               {
+                  wins++;
+                  gains += trade;
+               }
+               else losses -= trade;
+            }
+            if(position != 0.0 && (held == 0.0 || (position > 0.0) != (held > 0.0)))
+            {
+               tradeStart = equity;
+            }
+            held = position;
+         }
+
+         equity *= 1.0 + held * returns[index];
+         if(held != 0.0) exposed++;
+
+         double barReturn = equity / previous - 1.0;
+         sum += barReturn;
+         sumOfSquares += barReturn * barReturn;
+
+         peak = std::max(peak, equity);
+         double drawdown = 1.0 - equity / peak;
+         statistics.maxDrawdown = std::max(statistics.maxDrawdown, drawdown);
+
+         if(curve != nullptr)
+         {
+            curve->equity[index] = equity;
+            curve->drawdown[index] = drawdown;
+         }
+      }
+
+      // A trade, which is still open, is closed at the last bar without costs.
+      if(held != 0.0)
+      {
+         double trade = equity / tradeStart - 1.0;
+         statistics.trades++;
+         if(trade > 0.0)
+         {
+            wins++;
+            gains += trade;
+         }
+         else losses -= trade;
+      }
+
+      size_t bars = size - 1;
+      double mean = sum / bars;
+      double variance = std::max(sumOfSquares / bars - mean * mean, 0.0);
+
+      statistics.totalReturn = equity - 1.0;
+      statistics.exposure = (double)exposed / bars;
+      if(variance > 0.0)
+      {
+         statistics.sharpe = mean / std::sqrt(variance) * std::sqrt(mOptions.periodsPerYear);
+      }
+      if(statistics.trades > 0)
+      {
+         statistics.winRate = (double)wins / statistics.trades;
+         statistics.profitFactor = losses > 0.0 ? gains / losses
+                                                : std::numeric_limits<double>::infinity();
+      }
+      return statistics;
+   }
+}
@@ -0,0 +1,491 @@
+//
+//  Cli.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Command line interface for scripts and servers. It uses only the database and the computation
+//  code, so it starts without display and does not link libnuitk (Makefile target "cli").
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StockData.h"
+#include "Pipeline.h"
+#include "PriceCsvParser.h"
+#include "Profiler.h"
+
+static const char* kUsage =
+   "Usage: stocks-cli [--db FILE] [--snapshots DIRECTORY] [--trace FILE] COMMAND [ARGUMENTS]\n"
+   "\n"
+   "Commands:\n"
+   "  import SYMBOL FILE... [--name NAME] [--currency CURRENCY]\n"
+   "      Imports prices from CSV files (timestamp,open,high,low,close,volume).\n"
+   "      \"-\" reads from the standard input.\n"
+   "  list\n"
+   "      Lists all stocks with name, currency, date and close of the latest bar.\n"
+   "  compute SYMBOL INDICATOR [PARAMETERS...] [--last BARS] [--output FILE]\n"
+   "      Writes an indicator series as CSV. Indicators and their default parameters:\n"
+   "        sma PERIOD, ema PERIOD, rsi [14], atr [14], macd [12 26 9], bollinger [20 2]\n"
+   "  export SYMBOL [--from DATE] [--to DATE] [--output FILE]\n"
+   "      Writes the prices as CSV in the import format. Dates are YYYY-MM-DD.\n"
+   "  compress\n"
+   "      Stores the prices in compressed chunks. The database stays compressed.\n"
+   "\n"
+   "The database defaults to stocks.db, the output to the standard output.\n"
+   "--trace writes the timings as Chrome trace JSON, if built with PROFILE=1.\n";
+
+/*!
+ \brief The command line, split into positional arguments and options ("--name value").
+ */
+struct Arguments
+{
+   std::vector<std::string> positional;
+
+   std::map<std::string, std::string> options;
+
+   /*!
+    \brief Splits the command line.
+    \return False, if an option has no value.
+    */
+   bool parse(int argc, const char* argv[])
+   {
+      for(int index = 1; index < argc; index++)
+      {
+         std::string argument = argv[index];
+         if(argument.size() > 2 && argument.compare(0, 2, "--") == 0)
+         {
+            if(index + 1 >= argc)
+            {
+               std::cerr << "Option " << argument << " needs a value" << std::endl;
+               return false;
+            }
+            options[argument.substr(2)] = argv[++index];
+         }
+         else positional.push_back(argument);
+      }
+      return true;
+   }
+
+   /*!
+    \brief Returns the value of the option or the fallback, if the option is not set.
+    */
+   const char* option(const char* name, const char* fallback = nullptr) const
+   {
+      auto it = options.find(name);
+      return it != options.end() ? it->second.c_str() : fallback;
+   }
+};
+
+/*!
+ \brief Parses a date like "2025-09-01" into its day number.
+ */
+static bool parseDay(const char* text, int32& day)
+{
+   int year, month, date;
+   char rest;
+   if(std::sscanf(text, "%d-%d-%d%c", &year, &month, &date, &rest) != 3) return false;
+   if(month < 1 || month > 12 || date < 1 || date > 31) return false;
+   day = daysFromCivil(year, month, date);
+   return true;
+}
+
+/*!
+ \brief Parses a positive period.
+ */
+static bool parsePeriod(const char* text, int& period)
+{
+   char* end;
+   long value = std::strtol(text, &end, 10);
+   if(*end != '\0' || value <= 0 || value > 100000) return false;
+   period = (int)value;
+   return true;
+}
+
+/*!
+ \brief Buffered CSV output to a file or the standard output.
+ */
+class CsvWriter
+{
+   public:
+
+      /*!
+       \brief Opens the file. Without path, the standard output is used.
+       */
+      explicit CsvWriter(const char* path, char separator = ','): mSeparator(separator)
+      {
+         mFile = path != nullptr ? std::fopen(path, "wb") : stdout;
+         if(mFile == nullptr)
+         {
+            std::cerr << "Can't write " << path << std::endl;
+            return;
+         }
+         std::setvbuf(mFile, nullptr, _IOFBF, 1 << 20);
+      }
+
+      ~CsvWriter()
+      {
+         close();
+      }
+
+      bool isOpen() const
+      {
+         return mFile != nullptr;
+      }
+
+      void text(const char* value)
+      {
+         separate();
+         std::fputs(value, mFile);
+      }
+
+      //! Writes the date of the day number as YYYY-MM-DD.
+      void day(int32 day)
+      {
+         int32 year, month, date;
+         civilFromDays(day, year, month, date);
+         separate();
+         std::fprintf(mFile, "%04d-%02d-%02d", (int)year, (int)month, (int)date);
+      }
+
+      //! Writes the number. NaN is written as empty field.
+      void number(double value)
+      {
+         separate();
+         // 15 significant digits reproduce every decimal with up to 15 digits exactly.
+         if(!std::isnan(value)) std::fprintf(mFile, "%.15g", value);
+      }
+
+      void integer(int64 value)
+      {
+         separate();
+         std::fprintf(mFile, "%lld", (long long)value);
+      }
+
+      void endLine()
+      {
+         std::fputc('\n', mFile);
+         mFields = 0;
+      }
+
+      /*!
+       \brief Flushes and closes the output.
+       \return False, if writing failed.
+       */
+      bool close()
+      {
+         if(mFile == nullptr) return false;
+         bool success = std::fflush(mFile) == 0 && !std::ferror(mFile);
+         if(mFile != stdout) success = std::fclose(mFile) == 0 && success;
+         mFile = nullptr;
+         if(!success) std::cerr << "Writing the output failed" << std::endl;
+         return success;
+      }
+
+   private:
+
+      std::FILE* mFile = nullptr;
+
+      char mSeparator;
+
+      //! Number of fields written in the current line.
+      size_t mFields = 0;
+
+      void separate()
+      {
+         if(mFields++ > 0) std::fputc(mSeparator, mFile);
+      }
+};
+
+/*!
+ \brief Imports the CSV files of a stock.
+ */
+static int importPrices(StockDatabase& db, const Arguments& args)
+{
+   if(args.positional.size() < 3)
+   {
+      std::cerr << kUsage;
+      return 2;
+   }
+
+   jm::String symbol(args.positional[1].c_str());
+   if(db.addStock(symbol, args.option("name", ""), args.option("currency", "")) < 0) return 1;
+
+   for(size_t index = 2; index < args.positional.size(); index++)
+   {
+      const std::string& path = args.positional[index];
+      std::FILE* file = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+      if(file == nullptr)
+      {
+         std::cerr << "Can't read " << path << std::endl;
+         return 1;
+      }
+
+      PriceCsvParser parser([&](std::span<const PriceRecord> records)
+      {
+         return db.insertPrices(symbol, records);
+      });
+
+      std::vector<char> buffer(1 << 16);
+      bool success = true;
+      size_t size;
+      while(success && (size = std::fread(buffer.data(), 1, buffer.size(), file)) > 0)
+      {
+         success = parser.feed(buffer.data(), size);
+      }
+      bool failed = std::ferror(file) != 0;
+      if(file != stdin) std::fclose(file);
+
+      if(success) success = parser.finish();
+      if(!success || failed)
+      {
+         std::cerr << "Import of " << path << " failed" << std::endl;
+         return 1;
+      }
+
+      std::cerr << path << ": " << parser.rows() << " records imported, " << parser.errors()
+                << " lines skipped" << std::endl;
+   }
+   return 0;
+}
+
+/*!
+ \brief Lists all stocks of the database.
+ */
+static int listStocks(StockDatabase& db)
+{
+   CsvWriter output(nullptr, '\t');
+
+   for(const jm::String& symbol : db.symbols())
+   {
+      std::unique_ptr<Stock> stock(db.stock(symbol, 1));
+      if(!stock) continue;
+
+      output.text(stock->symbol.toCString().constData());
+      output.text(stock->name.toCString().constData());
+      output.text(stock->currency.toCString().constData());
+
+      const PriceHistory& history = stock->priceHistory;
+      if(!history.empty())
+      {
+         output.day(history.days().back());
+         output.number(history.closes().back());
+      }
+      output.endLine();
+   }
+   return output.close() ? 0 : 1;
+}
+
+/*!
+ \brief Computes an indicator series of a stock.
+ */
+static int computeIndicator(StockDatabase& db, const Arguments& args)
+{
+   if(args.positional.size() < 3)
+   {
+      std::cerr << kUsage;
+      return 2;
+   }
+
+   std::unique_ptr<Stock> stock(db.stock(args.positional[1].c_str()));
+   if(!stock)
+   {
+      std::cerr << "Unknown stock " << args.positional[1] << std::endl;
+      return 1;
+   }
+
+   const std::string& indicator = args.positional[2];
+   const PriceHistory& history = stock->priceHistory;
+   indicators::IndicatorCache& cache = stock->indicatorCache;
+
+   // Parameters, which are not given, keep their defaults.
+   std::vector<double> parameters;
+   for(size_t index = 3; index < args.positional.size(); index++)
+   {
+      char* end;
+      parameters.push_back(std::strtod(args.positional[index].c_str(), &end));
+      if(*end != '\0' || !(parameters.back() > 0.0))
+      {
+         std::cerr << "Invalid parameter " << args.positional[index] << std::endl;
+         return 2;
+      }
+   }
+   auto period = [&](size_t index, int fallback)
+   {
+      return index < parameters.size() ? (int)parameters[index] : fallback;
+   };
+
+   std::vector<const char*> names;
+   std::vector<std::span<const double>> series;
+   std::vector<double> sma;
+
+   if(indicator == "sma" && parameters.size() == 1)
+   {
+      sma.resize(history.size());
+      pipeline::make(pipeline::Close(), pipeline::Sma<0>(period(0, 0))).run<1>(history, sma);
+      names = {"sma"};
+      series = {sma};
+   }
+   else if(indicator == "ema" && parameters.size() == 1)
+   {
+      names = {"ema"};
+      series = {cache.ema(history, period(0, 0))};
+   }
+   else if(indicator == "rsi" && parameters.size() <= 1)
+   {
+      names = {"rsi"};
+      series = {cache.rsi(history, period(0, 14))};
+   }
+   else if(indicator == "atr" && parameters.size() <= 1)
+   {
+      names = {"atr"};
+      series = {cache.atr(history, period(0, 14))};
+   }
+   else if(indicator == "macd" && (parameters.empty() || parameters.size() == 3))
+   {
+      indicators::MacdSeries macd = cache.macd(history, period(0, 12), period(1, 26), period(2, 9));
+      names = {"macd", "signal", "histogram"};
+      series = {macd.macd, macd.signal, macd.histogram};
+   }
+   else if(indicator == "bollinger" && (parameters.empty() || parameters.size() == 2))
+   {
+      double deviations = parameters.size() == 2 ? parameters[1] : 2.0;
+      indicators::BollingerSeries bands = cache.bollinger(history, period(0, 20), deviations);
+      names = {"lower", "middle", "upper"};
+      series = {bands.lower, bands.middle, bands.upper};
+   }
+   else
+   {
+      std::cerr << "Unknown indicator or wrong number of parameters: " << indicator << std::endl;
+      return 2;
+   }
+
+   size_t first = 0;
+   if(const char* last = args.option("last"))
+   {
+      int bars;
+      if(!parsePeriod(last, bars))
+      {
+         std::cerr << "Invalid number of bars " << last << std::endl;
+         return 2;
+      }
+      if((size_t)bars < history.size()) first = history.size() - bars;
+   }
+
+   CsvWriter output(args.option("output"));
+   if(!output.isOpen()) return 1;
+
+   output.text("date");
+   for(const char* name : names) output.text(name);
+   output.endLine();
+
+   const Column<int32>& days = history.days();
+   for(size_t index = first; index < history.size(); index++)
+   {
+      output.day(days[index]);
+      for(const std::span<const double>& values : series) output.number(values[index]);
+      output.endLine();
+   }
+   return output.close() ? 0 : 1;
+}
+
+/*!
+ \brief Exports the prices of a stock.
+ */
+static int exportPrices(StockDatabase& db, const Arguments& args)
+{
+   if(args.positional.size() != 2)
+   {
+      std::cerr << kUsage;
+      return 2;
+   }
+
+   int32 from = std::numeric_limits<int32>::min();
+   int32 to = std::numeric_limits<int32>::max();
+   if(args.option("from") && !parseDay(args.option("from"), from))
+   {
+      std::cerr << "Invalid date " << args.option("from") << std::endl;
+      return 2;
+   }
+   if(args.option("to") && !parseDay(args.option("to"), to))
+   {
+      std::cerr << "Invalid date " << args.option("to") << std::endl;
+      return 2;
+   }
+
+   std::unique_ptr<Stock> stock(db.stock(args.positional[1].c_str()));
+   if(!stock)
+   {
+      std::cerr << "Unknown stock " << args.positional[1] << std::endl;
+      return 1;
+   }
+
+   CsvWriter output(args.option("output"));
+   if(!output.isOpen()) return 1;
+
+   const PriceHistory& history = stock->priceHistory;
+   const Column<int32>& days = history.days();
+   size_t first = std::lower_bound(days.begin(), days.end(), from) - days.begin();
+   size_t end = std::upper_bound(days.begin(), days.end(), to) - days.begin();
+
+   for(const char* name : {"timestamp", "open", "high", "low", "close", "volume"})
+   {
+      output.text(name);
+   }
+   output.endLine();
+   for(size_t index = first; index < end; index++)
+   {
+      output.day(days[index]);
+      output.number(history.opens()[index]);
+      output.number(history.highs()[index]);
+      output.number(history.lows()[index]);
+      output.number(history.closes()[index]);
+      output.integer(history.volumes()[index]);
+      output.endLine();
+   }
+   return output.close() ? 0 : 1;
+}
+
+int main(int argc, const char* argv[])
+{
+   Arguments args;
+   if(!args.parse(argc, argv)) return 2;
+
+   if(args.positional.empty() || args.positional[0] == "help")
+   {
+      std::cerr << kUsage;
+      return args.positional.empty() ? 2 : 0;
+   }
+
+   const std::string& command = args.positional[0];
+   if(command != "import" && command != "list" && command != "compute" && command != "export" &&
+      command != "compress")
+   {
+      std::cerr << "Unknown command " << command << "\n\n" << kUsage;
+      return 2;
+   }
+
+   DatabaseOptions options;
+   options.snapshotDirectory = args.option("snapshots", "");
+
+   StockDatabase db(args.option("db", "stocks.db"), options);
+   if(!db.initSchema()) return 1;
+
+   int status;
+   if(command == "import") status = importPrices(db, args);
+   else if(command == "list") status = listStocks(db);
+   else if(command == "compute") status = computeIndicator(db, args);
+   else if(command == "export") status = exportPrices(db, args);
+   else status = db.compressPrices() ? 0 : 1;
+
+   const char* trace = args.option("trace");
+   if(trace != nullptr && !profiler::writeTrace(trace) && status == 0) status = 1;
+   return status;
+}
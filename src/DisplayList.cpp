@@ -0,0 +1,79 @@
+//
+//  DisplayList.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+void DisplayList::clear()
+{
+   mCommands.clear();
+   mColors.clear();
+   mTexts.clear();
+}
+
+bool DisplayList::empty() const
+{
+   return mCommands.empty();
+}
+
+size_t DisplayList::size() const
+{
+   return mCommands.size();
+}
+
+void DisplayList::setLineStyle(nui::LineStyle style)
+{
+   mCommands.push_back({Op::kLineStyle, (uint32)style, 0.0, 0.0, 0.0, 0.0});
+}
+
+void DisplayList::setFillColor(const jm::Color& color)
+{
+   mCommands.push_back({Op::kFillColor, (uint32)mColors.size(), 0.0, 0.0, 0.0, 0.0});
+   mColors.push_back(color);
+}
+
+void DisplayList::setStrokeColor(const jm::Color& color)
+{
+   mCommands.push_back({Op::kStrokeColor, (uint32)mColors.size(), 0.0, 0.0, 0.0, 0.0});
+   mColors.push_back(color);
+}
+
+void DisplayList::drawText(const jm::String& text, const jm::Point& point)
+{
+   mCommands.push_back({Op::kText, (uint32)mTexts.size(), point.x(), point.y(), 0.0, 0.0});
+   mTexts.push_back(text);
+}
+
+void DisplayList::moveTo(const jm::Point& point)
+{
+   mCommands.push_back({Op::kMoveTo, 0, point.x(), point.y(), 0.0, 0.0});
+}
+
+void DisplayList::lineTo(const jm::Point& point)
+{
+   mCommands.push_back({Op::kLineTo, 0, point.x(), point.y(), 0.0, 0.0});
+}
+
+void DisplayList::line(double x1, double y1, double x2, double y2)
+{
+   mCommands.push_back({Op::kLine, 0, x1, y1, x2, y2});
+}
+
+void DisplayList::rectangle(const jm::Rect& rect)
+{
+   mCommands.push_back({Op::kRectangle, 0, rect.left(), rect.top(), rect.width(), rect.height()});
+}
+
+void DisplayList::stroke()
+{
+   mCommands.push_back({Op::kStroke, 0, 0.0, 0.0, 0.0, 0.0});
+}
+
+void DisplayList::fill()
+{
+   mCommands.push_back({Op::kFill, 0, 0.0, 0.0, 0.0, 0.0});
+}
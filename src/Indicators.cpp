@@ -0,0 +1,456 @@
+//
+//  Indicators.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include "Indicators.h"
+#include "Kernels.h"
+
+namespace indicators
+{
+
+Ema::Ema(int period):
+   mPeriod(std::max(period, 1)),
+   mAlpha(2.0 / (mPeriod + 1))
+{
+}
+
+void Ema::reset()
+{
+   mCount = 0;
+   mValue = 0.0;
+}
+
+void Ema::compute(std::span<const double> input, std::span<double> output)
+{
+   reset();
+   for(size_t index = 0; index < input.size(); index++) output[index] = update(input[index]);
+}
+
+Macd::Macd(int shortPeriod, int longPeriod, int signalPeriod):
+   mShort(shortPeriod),
+   mLong(longPeriod),
+   mSignal(signalPeriod)
+{
+}
+
+void Macd::reset()
+{
+   mShort.reset();
+   mLong.reset();
+   mSignal.reset();
+}
+
+void Macd::compute(std::span<const double> closes,
+                   std::span<double> macd,
+                   std::span<double> signal,
+                   std::span<double> histogram)
+{
+   reset();
+   for(size_t index = 0; index < closes.size(); index++)
+   {
+      MacdValue value = update(closes[index]);
+      macd[index] = value.macd;
+      signal[index] = value.signal;
+      histogram[index] = value.histogram;
+   }
+}
+
+Rsi::Rsi(int period):
+   mPeriod(std::max(period, 1))
+{
+}
+
+void Rsi::reset()
+{
+   mCount = 0;
+   mPrevious = 0.0;
+   mGain = 0.0;
+   mLoss = 0.0;
+}
+
+void Rsi::compute(std::span<const double> closes, std::span<double> output)
+{
+   reset();
+   for(size_t index = 0; index < closes.size(); index++) output[index] = update(closes[index]);
+}
+
+Bollinger::Bollinger(int period, double deviations):
+   mPeriod(std::max(period, 1)),
+   mDeviations(deviations),
+   mWindow(mPeriod, 0.0)
+{
+}
+
+void Bollinger::reset()
+{
+   mCount = 0;
+   mNext = 0;
+   mMean = 0.0;
+   mSquares = 0.0;
+   mUntilResync = 0;
+}
+
+BollingerValue Bollinger::update(double close)
+{
+   size_t period = mPeriod;
+
+   if(mCount < period)
+   {
+      // Welford's update while the window fills
+      mWindow[mNext] = close;
+      mCount++;
+      double delta = close - mMean;
+      mMean += delta / mCount;
+      mSquares += delta * (close - mMean);
+   }
+   else
+   {
+      // Replace the oldest close
+      double oldest = mWindow[mNext];
+      mWindow[mNext] = close;
+      double oldMean = mMean;
+      mMean += (close - oldest) / period;
+      mSquares += (close - oldest) * (close - mMean + oldest - oldMean);
+   }
+   mNext = mNext + 1 < period ? mNext + 1 : 0;
+
+   if(mCount < period) return BollingerValue{kNoValue, kNoValue, kNoValue};
+
+   if(--mUntilResync <= 0)
+   {
+      // The order of the values does not matter, so the ring buffer is used as it is.
+      mMean = kernels::mean(mWindow.data(), period);
+      mSquares = kernels::variance(mWindow.data(), period) * period;
+      mUntilResync = mPeriod;
+   }
+
+   double width = mDeviations * std::sqrt(std::max(mSquares, 0.0) / period);
+   return BollingerValue{mMean - width, mMean, mMean + width};
+}
+
+void Bollinger::compute(std::span<const double> closes,
+                        std::span<double> lower,
+                        std::span<double> middle,
+                        std::span<double> upper)
+{
+   reset();
+   for(size_t index = 0; index < closes.size(); index++)
+   {
+      BollingerValue value = update(closes[index]);
+      lower[index] = value.lower;
+      middle[index] = value.middle;
+      upper[index] = value.upper;
+   }
+}
+
+Atr::Atr(int period):
+   mPeriod(std::max(period, 1))
+{
+}
+
+void Atr::reset()
+{
+   mCount = 0;
+   mPrevious = 0.0;
+   mValue = 0.0;
+}
+
+void Atr::compute(std::span<const double> highs,
+                  std::span<const double> lows,
+                  std::span<const double> closes,
+                  std::span<double> output)
+{
+   reset();
+   for(size_t index = 0; index < closes.size(); index++)
+   {
+      output[index] = update(highs[index], lows[index], closes[index]);
+   }
+}
+
+std::vector<double> SeriesPool::acquire(size_t size)
+{
+   std::vector<double> buffer;
+   if(!mFree.empty())
+   {
+      buffer = std::move(mFree.back());
+      mFree.pop_back();
+   }
+   buffer.resize(size);
+   return buffer;
+}
+
+void SeriesPool::release(std::vector<double>&& buffer)
+{
+   if(buffer.capacity() > 0) mFree.push_back(std::move(buffer));
+}
+
+void SeriesPool::clear()
+{
+   mFree.clear();
+}
+
+//! Identifies the indicator type in the cache keys.
+enum IndicatorType
+{
+   kEmaType,
+   kMacdType,
+   kRsiType,
+   kBollingerType,
+   kAtrType
+};
+
+/*!
+ \brief Pointers to the columns of the bars, passed to the indicator steps.
+ */
+struct Bars
+{
+   const double* highs;
+   const double* lows;
+   const double* closes;
+};
+
+static void step(Ema& ema, const Bars& bars, size_t index, std::vector<double>* outputs)
+{
+   outputs[0][index] = ema.update(bars.closes[index]);
+}
+
+static void step(Macd& macd, const Bars& bars, size_t index, std::vector<double>* outputs)
+{
+   MacdValue value = macd.update(bars.closes[index]);
+   outputs[0][index] = value.macd;
+   outputs[1][index] = value.signal;
+   outputs[2][index] = value.histogram;
+}
+
+static void step(Rsi& rsi, const Bars& bars, size_t index, std::vector<double>* outputs)
+{
+   outputs[0][index] = rsi.update(bars.closes[index]);
+}
+
+static void step(Bollinger& bollinger, const Bars& bars, size_t index, std::vector<double>* outputs)
+{
+   BollingerValue value = bollinger.update(bars.closes[index]);
+   outputs[0][index] = value.lower;
+   outputs[1][index] = value.middle;
+   outputs[2][index] = value.upper;
+}
+
+static void step(Atr& atr, const Bars& bars, size_t index, std::vector<double>* outputs)
+{
+   outputs[0][index] = atr.update(bars.highs[index], bars.lows[index], bars.closes[index]);
+}
+
+struct IndicatorCache::Entry
+{
+   Key key;
+
+   //! Number of used outputs.
+   int outputCount;
+
+   std::vector<double> outputs[3];
+
+   //! Version of the history, the outputs were computed for.
+   uint64 version = 0;
+
+   uint64 baseVersion = 0;
+
+   //! Number of computed bars.
+   size_t count = 0;
+
+   Entry(const Key& key, int outputCount): key(key), outputCount(outputCount) {}
+
+   virtual ~Entry() = default;
+
+   /*!
+    \brief Computes the outputs of the bars, which changed since the last call.
+    \return The number of computed bars.
+    */
+   size_t refresh(const PriceHistory& history)
+   {
+      if(version == history.version()) return 0;
+
+      size_t size = history.size();
+      size_t from = 0;
+
+      // Only appended bars and the replaced last bar are new, resume before the last known bar.
+      if(baseVersion == history.baseVersion() && count > 0 && count <= size)
+      {
+         resume();
+         from = count - 1;
+      }
+      else restart();
+
+      for(int index = 0; index < outputCount; index++) outputs[index].resize(size);
+
+      Bars bars = {history.highs().data(), history.lows().data(), history.closes().data()};
+      run(bars, from, size);
+
+      version = history.version();
+      baseVersion = history.baseVersion();
+      count = size;
+      return size - from;
+   }
+
+   //! Resets the indicator.
+   virtual void restart() = 0;
+
+   //! Restores the indicator state before the last computed bar.
+   virtual void resume() = 0;
+
+   //! Computes the bars from to to (excluding) and keeps the state before the last one.
+   virtual void run(const Bars& bars, size_t from, size_t to) = 0;
+};
+
+template<class Indicator>
+struct IndicatorCache::IndicatorEntry: public IndicatorCache::Entry
+{
+   Indicator indicator;
+
+   //! State before the last computed bar.
+   Indicator checkpoint;
+
+   IndicatorEntry(const Key& key, int outputCount, const Indicator& indicator):
+      Entry(key, outputCount),
+      indicator(indicator),
+      checkpoint(indicator)
+   {
+   }
+
+   void restart() override
+   {
+      indicator.reset();
+   }
+
+   void resume() override
+   {
+      indicator = checkpoint;
+   }
+
+   void run(const Bars& bars, size_t from, size_t to) override
+   {
+      for(size_t index = from; index < to; index++)
+      {
+         if(index + 1 == to) checkpoint = indicator;
+         step(indicator, bars, index, outputs);
+      }
+   }
+};
+
+IndicatorCache::IndicatorCache()
+{
+}
+
+IndicatorCache::IndicatorCache(const IndicatorCache&)
+{
+}
+
+IndicatorCache& IndicatorCache::operator=(const IndicatorCache&)
+{
+   clear();
+   return *this;
+}
+
+IndicatorCache::~IndicatorCache()
+{
+}
+
+template<class Indicator, class Factory>
+IndicatorCache::Entry& IndicatorCache::series(const PriceHistory& history,
+                                              const Key& key,
+                                              Factory factory)
+{
+   Entry* entry = nullptr;
+   for(const auto& candidate : mEntries)
+   {
+      if(candidate->key == key)
+      {
+         entry = candidate.get();
+         break;
+      }
+   }
+
+   if(entry == nullptr)
+   {
+      mEntries.push_back(factory());
+      entry = mEntries.back().get();
+   }
+
+   mComputedBars += entry->refresh(history);
+   return *entry;
+}
+
+std::span<const double> IndicatorCache::ema(const PriceHistory& history, int period)
+{
+   Key key = {kEmaType, {(double)period, 0, 0}};
+   Entry& entry = series<Ema>(history, key, [&]
+   {
+      return std::make_unique<IndicatorEntry<Ema>>(key, 1, Ema(period));
+   });
+   return entry.outputs[0];
+}
+
+MacdSeries IndicatorCache::macd(const PriceHistory& history,
+                                int shortPeriod,
+                                int longPeriod,
+                                int signalPeriod)
+{
+   Key key = {kMacdType, {(double)shortPeriod, (double)longPeriod, (double)signalPeriod}};
+   Entry& entry = series<Macd>(history, key, [&]
+   {
+      return std::make_unique<IndicatorEntry<Macd>>(key, 3, Macd(shortPeriod, longPeriod, signalPeriod));
+   });
+   return MacdSeries{entry.outputs[0], entry.outputs[1], entry.outputs[2]};
+}
+
+std::span<const double> IndicatorCache::rsi(const PriceHistory& history, int period)
+{
+   Key key = {kRsiType, {(double)period, 0, 0}};
+   Entry& entry = series<Rsi>(history, key, [&]
+   {
+      return std::make_unique<IndicatorEntry<Rsi>>(key, 1, Rsi(period));
+   });
+   return entry.outputs[0];
+}
+
+BollingerSeries IndicatorCache::bollinger(const PriceHistory& history, int period, double deviations)
+{
+   Key key = {kBollingerType, {(double)period, deviations, 0}};
+   Entry& entry = series<Bollinger>(history, key, [&]
+   {
+      return std::make_unique<IndicatorEntry<Bollinger>>(key, 3, Bollinger(period, deviations));
+   });
+   return BollingerSeries{entry.outputs[0], entry.outputs[1], entry.outputs[2]};
+}
+
+std::span<const double> IndicatorCache::atr(const PriceHistory& history, int period)
+{
+   Key key = {kAtrType, {(double)period, 0, 0}};
+   Entry& entry = series<Atr>(history, key, [&]
+   {
+      return std::make_unique<IndicatorEntry<Atr>>(key, 1, Atr(period));
+   });
+   return entry.outputs[0];
+}
+
+size_t IndicatorCache::size() const
+{
+   return mEntries.size();
+}
+
+size_t IndicatorCache::computedBars() const
+{
+   return mComputedBars;
+}
+
+void IndicatorCache::clear()
+{
+   mEntries.clear();
+}
+
+}
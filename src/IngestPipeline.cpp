@@ -0,0 +1,403 @@
+//
+//  IngestPipeline.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include "IngestPipeline.h"
+#include "PriceCsvParser.h"
+
+//! Longest wait of the fetch thread, before it checks the rate limiter and the cancel flag again.
+static const int kMaxPollMillis = 1000;
+
+RateLimiter::RateLimiter(int requests, std::chrono::milliseconds period):
+   mCapacity(requests),
+   mTokens(requests),
+   mRate(period.count() > 0 ? requests / (double)period.count() : 0.0),
+   mLast(Clock::now())
+{
+}
+
+std::chrono::milliseconds RateLimiter::acquire(Clock::time_point now)
+{
+   if(mCapacity <= 0 || mRate <= 0) return std::chrono::milliseconds(0);
+
+   double elapsed = std::chrono::duration<double, std::milli>(now - mLast).count();
+   if(elapsed > 0)
+   {
+      mTokens = std::min(mCapacity, mTokens + elapsed * mRate);
+      mLast = now;
+   }
+
+   if(mTokens >= 1.0)
+   {
+      mTokens -= 1.0;
+      return std::chrono::milliseconds(0);
+   }
+
+   return std::chrono::milliseconds((int64)std::ceil((1.0 - mTokens) / mRate));
+}
+
+/*!
+ \brief A running download.
+ */
+struct IngestPipeline::Transfer
+{
+   size_t symbol;
+   CURL* handle;
+   std::unique_ptr<PriceCsvParser> parser;
+   std::string url;
+
+   //! Set by the batch handler, if the writer queue is closed (cancel).
+   bool aborted = false;
+};
+
+IngestPipeline::IngestPipeline(const jm::String& dbFile,
+                               const DatabaseOptions& dbOptions,
+                               const IngestOptions& options):
+   mDbFile(dbFile.toCString().constData()),
+   mDbOptions(dbOptions),
+   mOptions(options)
+{
+}
+
+IngestPipeline::~IngestPipeline()
+{
+   cancel();
+   wait();
+}
+
+// Symbolsuche: Scheint ohne API-Key zu funktionieren
+// Liefert:
+// symbol,name,type,region,marketOpen,marketClose,timezone,currency,matchScore
+// BMW.FRK,Bayerische Motoren Werke Aktiengesellschaft,Equity,Frankfurt,08:00,20:00,UTC+02,EUR,0.7500
+// https://www.alphavantage.co/query?function=SYMBOL_SEARCH&keywords=microsoft&datatype=csv&apikey=DEIN_API_KEY
+
+std::string IngestPipeline::queryUrl(const std::string& symbol) const
+{
+   std::string base = mOptions.baseUrl.toCString().constData();
+   std::string apiKey = mOptions.apiKey.toCString().constData();
+
+   char* escaped = curl_easy_escape(nullptr, symbol.c_str(), (int)symbol.size());
+   std::string url = base + (base.find('?') == std::string::npos ? "?" : "&")
+                     + "function=TIME_SERIES_DAILY&symbol=" + (escaped ? escaped : symbol.c_str())
+                     + "&outputsize=full&datatype=csv&apikey=" + apiKey;
+   curl_free(escaped);
+   return url;
+}
+
+bool IngestPipeline::start(const std::vector<jm::String>& symbols, ProgressHandler handler)
+{
+   if(mRunning) return false;
+   wait();
+
+   // curl_global_init is not thread safe with older curl versions, so it is done before any
+   // handle is created on the fetch thread.
+   static std::once_flag curlInitialized;
+   std::call_once(curlInitialized, []{ curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+   mSymbols.clear();
+   for(const jm::String& symbol : symbols) mSymbols.push_back(symbol.toCString().constData());
+   mHandler = std::move(handler);
+
+   mCancelled = false;
+   mFetchDone = false;
+   mQueue.clear();
+   mFailed.clear();
+   mFetched = 0;
+   mWritten = 0;
+   mFailedCount = 0;
+   mRows = 0;
+   mBytes = 0;
+
+   mRunning = true;
+   mWriterThread = std::thread(&IngestPipeline::write, this);
+   mFetchThread = std::thread(&IngestPipeline::fetch, this);
+   return true;
+}
+
+void IngestPipeline::cancel()
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   mCancelled = true;
+   if(mMulti != nullptr) curl_multi_wakeup(mMulti);
+   mQueueChanged.notify_all();
+}
+
+void IngestPipeline::wait()
+{
+   if(mFetchThread.joinable()) mFetchThread.join();
+   if(mWriterThread.joinable()) mWriterThread.join();
+}
+
+bool IngestPipeline::running() const
+{
+   return mRunning;
+}
+
+IngestProgress IngestPipeline::progress() const
+{
+   IngestProgress progress;
+   progress.symbols = mSymbols.size();
+   progress.fetched = mFetched;
+   progress.written = mWritten;
+   progress.failed = mFailedCount;
+   progress.rows = mRows;
+   progress.bytes = mBytes;
+   progress.cancelled = mCancelled;
+   progress.finished = !mRunning;
+   return progress;
+}
+
+std::vector<jm::String> IngestPipeline::failedSymbols() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   std::vector<jm::String> symbols;
+   for(size_t index : mFailed) symbols.push_back(jm::String(mSymbols[index].c_str()));
+   return symbols;
+}
+
+bool IngestPipeline::push(Job&& job)
+{
+   std::unique_lock<std::mutex> lock(mMutex);
+
+   // The end of a symbol is always accepted, so a finished download never waits.
+   mQueueChanged.wait(lock, [&]
+   {
+      return mCancelled || job.last || mQueue.size() < mOptions.maxQueuedBatches;
+   });
+   if(mCancelled) return false;
+
+   mQueue.push_back(std::move(job));
+   mQueueChanged.notify_all();
+   return true;
+}
+
+std::vector<PriceRecord> IngestPipeline::takeBatch()
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   if(mFreeBatches.empty()) return std::vector<PriceRecord>();
+
+   std::vector<PriceRecord> batch = std::move(mFreeBatches.back());
+   mFreeBatches.pop_back();
+   return batch;
+}
+
+void IngestPipeline::finishTransfer(Transfer* transfer, bool success)
+{
+   const std::string& symbol = mSymbols[transfer->symbol];
+
+   long status = 0;
+   if(transfer->handle != nullptr) curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &status);
+   if(success && status != 200)
+   {
+      std::cerr << "Download of " << symbol << " failed: HTTP " << status << std::endl;
+      success = false;
+   }
+
+   if(success && !transfer->parser->finish()) success = false;
+
+   // Alpha Vantage answers errors and quota messages with status 200 and a JSON text.
+   if(success && transfer->parser->rows() == 0)
+   {
+      std::cerr << "Download of " << symbol << " contains no prices" << std::endl;
+      success = false;
+   }
+
+   mFetched++;
+
+   Job job;
+   job.symbol = transfer->symbol;
+   job.last = true;
+   job.success = success;
+   push(std::move(job));
+}
+
+void IngestPipeline::fetch()
+{
+   CURLM* multi = curl_multi_init();
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mMulti = multi;
+   }
+
+   RateLimiter limiter(mOptions.requestsPerPeriod, mOptions.quotaPeriod);
+   std::vector<std::unique_ptr<Transfer>> transfers;
+   size_t next = 0;
+
+   while(multi != nullptr && !mCancelled && (next < mSymbols.size() || !transfers.empty()))
+   {
+      int pollMillis = kMaxPollMillis;
+
+      // Stage 1: start new downloads, as far as connections and quota allow.
+      while(next < mSymbols.size() && (int)transfers.size() < std::max(mOptions.maxConnections, 1))
+      {
+         std::chrono::milliseconds delay = limiter.acquire();
+         if(delay.count() > 0)
+         {
+            pollMillis = (int)std::min<int64>(delay.count(), kMaxPollMillis);
+            break;
+         }
+
+         auto transfer = std::make_unique<Transfer>();
+         Transfer* current = transfer.get();
+         current->symbol = next++;
+         current->url = queryUrl(mSymbols[current->symbol]);
+
+         // Stage 2: parse the response while it arrives, batches go to the writer queue.
+         current->parser = std::make_unique<PriceCsvParser>(
+            [this, current](std::span<const PriceRecord> records)
+            {
+               Job job;
+               job.symbol = current->symbol;
+               job.records = takeBatch();
+               job.records.assign(records.begin(), records.end());
+               if(!push(std::move(job))) current->aborted = true;
+               return !current->aborted;
+            },
+            mOptions.batchSize);
+
+         current->handle = curl_easy_init();
+         if(current->handle == nullptr)
+         {
+            std::cerr << "curl_easy_init() failed" << std::endl;
+            finishTransfer(current, false);
+            continue;
+         }
+
+         curl_easy_setopt(current->handle, CURLOPT_URL, current->url.c_str());
+         curl_easy_setopt(current->handle, CURLOPT_WRITEFUNCTION, +[](char* data, size_t size, size_t count, void* user)
+         {
+            Transfer* transfer = (Transfer*)user;
+            return PriceCsvParser::curlWriteCallback(data, size, count, transfer->parser.get());
+         });
+         curl_easy_setopt(current->handle, CURLOPT_WRITEDATA, current);
+         curl_easy_setopt(current->handle, CURLOPT_PRIVATE, current);
+         curl_easy_setopt(current->handle, CURLOPT_USERAGENT, "libcurl-agent/1.0"); // Verhindert Blockierung
+         curl_easy_setopt(current->handle, CURLOPT_ACCEPT_ENCODING, "");
+         curl_easy_setopt(current->handle, CURLOPT_NOSIGNAL, 1L);
+         curl_easy_setopt(current->handle, CURLOPT_TIMEOUT, (long)mOptions.timeout);
+         curl_multi_add_handle(multi, current->handle);
+         transfers.push_back(std::move(transfer));
+      }
+
+      int active = 0;
+      curl_multi_perform(multi, &active);
+
+      int queued = 0;
+      while(CURLMsg* message = curl_multi_info_read(multi, &queued))
+      {
+         if(message->msg != CURLMSG_DONE) continue;
+
+         Transfer* transfer = nullptr;
+         curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**)&transfer);
+
+         if(message->data.result != CURLE_OK && !transfer->aborted)
+         {
+            std::cerr << "Download of " << mSymbols[transfer->symbol] << " failed: "
+                      << curl_easy_strerror(message->data.result) << std::endl;
+         }
+
+         curl_off_t bytes = 0;
+         curl_easy_getinfo(message->easy_handle, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+         mBytes += (size_t)bytes;
+
+         finishTransfer(transfer, message->data.result == CURLE_OK);
+
+         curl_multi_remove_handle(multi, transfer->handle);
+         curl_easy_cleanup(transfer->handle);
+         std::erase_if(transfers, [transfer](const auto& entry) { return entry.get() == transfer; });
+      }
+
+      // Sleeps until data arrives, a new token is due or cancel() wakes up the thread.
+      if(!mCancelled && (active > 0 || next < mSymbols.size()))
+      {
+         curl_multi_poll(multi, nullptr, 0, pollMillis, nullptr);
+      }
+   }
+
+   for(const auto& transfer : transfers)
+   {
+      curl_multi_remove_handle(multi, transfer->handle);
+      curl_easy_cleanup(transfer->handle);
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mMulti = nullptr;
+      mFetchDone = true;
+      mQueueChanged.notify_all();
+   }
+   if(multi != nullptr) curl_multi_cleanup(multi);
+}
+
+void IngestPipeline::write()
+{
+   StockDatabase db(jm::String(mDbFile.c_str()), mDbOptions);
+   bool ready = db.initSchema();
+   if(!ready) std::cerr << "Failed to initialize DB schema\n";
+
+   // Symbols, whose batches failed to write. Their remaining batches are skipped.
+   std::vector<bool> writeFailed(mSymbols.size(), false);
+
+   while(true)
+   {
+      Job job;
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mQueueChanged.wait(lock, [&] { return mCancelled || mFetchDone || !mQueue.empty(); });
+         if(mCancelled || mQueue.empty()) break;
+
+         job = std::move(mQueue.front());
+         mQueue.pop_front();
+         mQueueChanged.notify_all();
+      }
+
+      jm::String symbol(mSymbols[job.symbol].c_str());
+
+      if(!job.last)
+      {
+         if(!ready || writeFailed[job.symbol]) continue;
+
+         if(db.addStock(symbol, symbol, "") < 0 || !db.insertPrices(symbol, job.records))
+         {
+            writeFailed[job.symbol] = true;
+         }
+         else mRows += job.records.size();
+
+         job.records.clear();
+         std::lock_guard<std::mutex> lock(mMutex);
+         mFreeBatches.push_back(std::move(job.records));
+         continue;
+      }
+
+      if(ready && job.success && !writeFailed[job.symbol])
+      {
+         mWritten++;
+      }
+      else
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         mFailed.push_back(job.symbol);
+         mFailedCount++;
+      }
+      reportProgress();
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQueue.clear();
+      mFreeBatches.clear();
+   }
+   mRunning = false;
+   reportProgress();
+}
+
+void IngestPipeline::reportProgress()
+{
+   if(mHandler) mHandler(progress());
+}
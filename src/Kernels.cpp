@@ -0,0 +1,514 @@
+//
+//  Kernels.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include <atomic>
+
+#include "Kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KERNELS_X86_64 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+/*!
+ \brief Function table of one instruction set.
+ */
+struct KernelTable
+{
+   kernels::Isa isa;
+   double (*minimumDouble)(const double*, size_t);
+   double (*maximumDouble)(const double*, size_t);
+   int64 (*minimumInt)(const int64*, size_t);
+   int64 (*maximumInt)(const int64*, size_t);
+   double (*sum)(const double*, size_t);
+   double (*squaredDeviation)(const double*, size_t, double);
+
+   //! Sum of the true ranges of the bars 1 to count-1.
+   double (*trueRange)(const double*, const double*, const double*, size_t);
+};
+
+//
+// Scalar
+//
+
+double minimumDoubleScalar(const double* values, size_t count)
+{
+   double result = values[0];
+   for(size_t index = 1; index < count; index++) if(values[index] < result) result = values[index];
+   return result;
+}
+
+double maximumDoubleScalar(const double* values, size_t count)
+{
+   double result = values[0];
+   for(size_t index = 1; index < count; index++) if(values[index] > result) result = values[index];
+   return result;
+}
+
+int64 minimumIntScalar(const int64* values, size_t count)
+{
+   int64 result = values[0];
+   for(size_t index = 1; index < count; index++) if(values[index] < result) result = values[index];
+   return result;
+}
+
+int64 maximumIntScalar(const int64* values, size_t count)
+{
+   int64 result = values[0];
+   for(size_t index = 1; index < count; index++) if(values[index] > result) result = values[index];
+   return result;
+}
+
+double sumScalar(const double* values, size_t count)
+{
+   double result = 0.0;
+   for(size_t index = 0; index < count; index++) result += values[index];
+   return result;
+}
+
+double squaredDeviationScalar(const double* values, size_t count, double mean)
+{
+   double result = 0.0;
+   for(size_t index = 0; index < count; index++)
+   {
+      double delta = values[index] - mean;
+      result += delta * delta;
+   }
+   return result;
+}
+
+double trueRangeScalar(const double* highs, const double* lows, const double* closes, size_t count)
+{
+   double result = 0.0;
+   for(size_t index = 1; index < count; index++)
+   {
+      double previous = closes[index - 1];
+      result += std::max(highs[index] - lows[index],
+                         std::max(std::abs(highs[index] - previous),
+                                  std::abs(lows[index] - previous)));
+   }
+   return result;
+}
+
+const KernelTable kScalarTable =
+{
+   kernels::Isa::kScalar,
+   minimumDoubleScalar,
+   maximumDoubleScalar,
+   minimumIntScalar,
+   maximumIntScalar,
+   sumScalar,
+   squaredDeviationScalar,
+   trueRangeScalar
+};
+
+#ifdef KERNELS_X86_64
+
+//
+// SSE2 (baseline of x86-64, no runtime check needed)
+//
+
+double horizontalMin(__m128d value)
+{
+   return _mm_cvtsd_f64(_mm_min_sd(value, _mm_unpackhi_pd(value, value)));
+}
+
+double horizontalMax(__m128d value)
+{
+   return _mm_cvtsd_f64(_mm_max_sd(value, _mm_unpackhi_pd(value, value)));
+}
+
+double horizontalSum(__m128d value)
+{
+   return _mm_cvtsd_f64(_mm_add_sd(value, _mm_unpackhi_pd(value, value)));
+}
+
+double minimumDoubleSSE2(const double* values, size_t count)
+{
+   __m128d acc0 = _mm_set1_pd(values[0]);
+   __m128d acc1 = acc0;
+   size_t index = 0;
+   for(; index + 4 <= count; index += 4)
+   {
+      acc0 = _mm_min_pd(acc0, _mm_loadu_pd(values + index));
+      acc1 = _mm_min_pd(acc1, _mm_loadu_pd(values + index + 2));
+   }
+   double result = horizontalMin(_mm_min_pd(acc0, acc1));
+   for(; index < count; index++) result = std::min(result, values[index]);
+   return result;
+}
+
+double maximumDoubleSSE2(const double* values, size_t count)
+{
+   __m128d acc0 = _mm_set1_pd(values[0]);
+   __m128d acc1 = acc0;
+   size_t index = 0;
+   for(; index + 4 <= count; index += 4)
+   {
+      acc0 = _mm_max_pd(acc0, _mm_loadu_pd(values + index));
+      acc1 = _mm_max_pd(acc1, _mm_loadu_pd(values + index + 2));
+   }
+   double result = horizontalMax(_mm_max_pd(acc0, acc1));
+   for(; index < count; index++) result = std::max(result, values[index]);
+   return result;
+}
+
+double sumSSE2(const double* values, size_t count)
+{
+   __m128d acc0 = _mm_setzero_pd();
+   __m128d acc1 = _mm_setzero_pd();
+   size_t index = 0;
+   for(; index + 4 <= count; index += 4)
+   {
+      acc0 = _mm_add_pd(acc0, _mm_loadu_pd(values + index));
+      acc1 = _mm_add_pd(acc1, _mm_loadu_pd(values + index + 2));
+   }
+   double result = horizontalSum(_mm_add_pd(acc0, acc1));
+   for(; index < count; index++) result += values[index];
+   return result;
+}
+
+double squaredDeviationSSE2(const double* values, size_t count, double mean)
+{
+   __m128d center = _mm_set1_pd(mean);
+   __m128d acc0 = _mm_setzero_pd();
+   __m128d acc1 = _mm_setzero_pd();
+   size_t index = 0;
+   for(; index + 4 <= count; index += 4)
+   {
+      __m128d delta0 = _mm_sub_pd(_mm_loadu_pd(values + index), center);
+      __m128d delta1 = _mm_sub_pd(_mm_loadu_pd(values + index + 2), center);
+      acc0 = _mm_add_pd(acc0, _mm_mul_pd(delta0, delta0));
+      acc1 = _mm_add_pd(acc1, _mm_mul_pd(delta1, delta1));
+   }
+   double result = horizontalSum(_mm_add_pd(acc0, acc1));
+   for(; index < count; index++)
+   {
+      double delta = values[index] - mean;
+      result += delta * delta;
+   }
+   return result;
+}
+
+double trueRangeSSE2(const double* highs, const double* lows, const double* closes, size_t count)
+{
+   if(count < 2) return 0.0;
+
+   const __m128d signMask = _mm_set1_pd(-0.0);
+   __m128d acc = _mm_setzero_pd();
+   size_t index = 1;
+   for(; index + 2 <= count; index += 2)
+   {
+      __m128d high = _mm_loadu_pd(highs + index);
+      __m128d low = _mm_loadu_pd(lows + index);
+      __m128d previous = _mm_loadu_pd(closes + index - 1);
+      __m128d range = _mm_sub_pd(high, low);
+      __m128d up = _mm_andnot_pd(signMask, _mm_sub_pd(high, previous));
+      __m128d down = _mm_andnot_pd(signMask, _mm_sub_pd(low, previous));
+      acc = _mm_add_pd(acc, _mm_max_pd(range, _mm_max_pd(up, down)));
+   }
+   double result = horizontalSum(acc);
+   return result + trueRangeScalar(highs + index - 1, lows + index - 1, closes + index - 1, count - index + 1);
+}
+
+const KernelTable kSSE2Table =
+{
+   kernels::Isa::kSSE2,
+   minimumDoubleSSE2,
+   maximumDoubleSSE2,
+   minimumIntScalar,
+   maximumIntScalar,
+   sumSSE2,
+   squaredDeviationSSE2,
+   trueRangeSSE2
+};
+
+//
+// AVX2
+//
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 __m128d foldMin(__m256d value)
+{
+   return _mm_min_pd(_mm256_castpd256_pd128(value), _mm256_extractf128_pd(value, 1));
+}
+
+AVX2 __m128d foldMax(__m256d value)
+{
+   return _mm_max_pd(_mm256_castpd256_pd128(value), _mm256_extractf128_pd(value, 1));
+}
+
+AVX2 __m128d foldSum(__m256d value)
+{
+   return _mm_add_pd(_mm256_castpd256_pd128(value), _mm256_extractf128_pd(value, 1));
+}
+
+AVX2 double minimumDoubleAVX2(const double* values, size_t count)
+{
+   __m256d acc0 = _mm256_set1_pd(values[0]);
+   __m256d acc1 = acc0, acc2 = acc0, acc3 = acc0;
+   size_t index = 0;
+   for(; index + 16 <= count; index += 16)
+   {
+      acc0 = _mm256_min_pd(acc0, _mm256_loadu_pd(values + index));
+      acc1 = _mm256_min_pd(acc1, _mm256_loadu_pd(values + index + 4));
+      acc2 = _mm256_min_pd(acc2, _mm256_loadu_pd(values + index + 8));
+      acc3 = _mm256_min_pd(acc3, _mm256_loadu_pd(values + index + 12));
+   }
+   __m256d acc = _mm256_min_pd(_mm256_min_pd(acc0, acc1), _mm256_min_pd(acc2, acc3));
+   double result = horizontalMin(foldMin(acc));
+   for(; index < count; index++) result = std::min(result, values[index]);
+   return result;
+}
+
+AVX2 double maximumDoubleAVX2(const double* values, size_t count)
+{
+   __m256d acc0 = _mm256_set1_pd(values[0]);
+   __m256d acc1 = acc0, acc2 = acc0, acc3 = acc0;
+   size_t index = 0;
+   for(; index + 16 <= count; index += 16)
+   {
+      acc0 = _mm256_max_pd(acc0, _mm256_loadu_pd(values + index));
+      acc1 = _mm256_max_pd(acc1, _mm256_loadu_pd(values + index + 4));
+      acc2 = _mm256_max_pd(acc2, _mm256_loadu_pd(values + index + 8));
+      acc3 = _mm256_max_pd(acc3, _mm256_loadu_pd(values + index + 12));
+   }
+   __m256d acc = _mm256_max_pd(_mm256_max_pd(acc0, acc1), _mm256_max_pd(acc2, acc3));
+   double result = horizontalMax(foldMax(acc));
+   for(; index < count; index++) result = std::max(result, values[index]);
+   return result;
+}
+
+AVX2 int64 minimumIntAVX2(const int64* values, size_t count)
+{
+   __m256i acc0 = _mm256_set1_epi64x(values[0]);
+   __m256i acc1 = acc0;
+   size_t index = 0;
+   for(; index + 8 <= count; index += 8)
+   {
+      __m256i value0 = _mm256_loadu_si256((const __m256i*)(values + index));
+      __m256i value1 = _mm256_loadu_si256((const __m256i*)(values + index + 4));
+      acc0 = _mm256_blendv_epi8(acc0, value0, _mm256_cmpgt_epi64(acc0, value0));
+      acc1 = _mm256_blendv_epi8(acc1, value1, _mm256_cmpgt_epi64(acc1, value1));
+   }
+   acc0 = _mm256_blendv_epi8(acc0, acc1, _mm256_cmpgt_epi64(acc0, acc1));
+
+   alignas(32) int64 lanes[4];
+   _mm256_store_si256((__m256i*)lanes, acc0);
+   int64 result = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+   for(; index < count; index++) result = std::min(result, values[index]);
+   return result;
+}
+
+AVX2 int64 maximumIntAVX2(const int64* values, size_t count)
+{
+   __m256i acc0 = _mm256_set1_epi64x(values[0]);
+   __m256i acc1 = acc0;
+   size_t index = 0;
+   for(; index + 8 <= count; index += 8)
+   {
+      __m256i value0 = _mm256_loadu_si256((const __m256i*)(values + index));
+      __m256i value1 = _mm256_loadu_si256((const __m256i*)(values + index + 4));
+      acc0 = _mm256_blendv_epi8(acc0, value0, _mm256_cmpgt_epi64(value0, acc0));
+      acc1 = _mm256_blendv_epi8(acc1, value1, _mm256_cmpgt_epi64(value1, acc1));
+   }
+   acc0 = _mm256_blendv_epi8(acc0, acc1, _mm256_cmpgt_epi64(acc1, acc0));
+
+   alignas(32) int64 lanes[4];
+   _mm256_store_si256((__m256i*)lanes, acc0);
+   int64 result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+   for(; index < count; index++) result = std::max(result, values[index]);
+   return result;
+}
+
+AVX2 double sumAVX2(const double* values, size_t count)
+{
+   __m256d acc0 = _mm256_setzero_pd();
+   __m256d acc1 = acc0, acc2 = acc0, acc3 = acc0;
+   size_t index = 0;
+   for(; index + 16 <= count; index += 16)
+   {
+      acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + index));
+      acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + index + 4));
+      acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(values + index + 8));
+      acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(values + index + 12));
+   }
+   __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+   double result = horizontalSum(foldSum(acc));
+   for(; index < count; index++) result += values[index];
+   return result;
+}
+
+AVX2 double squaredDeviationAVX2(const double* values, size_t count, double mean)
+{
+   __m256d center = _mm256_set1_pd(mean);
+   __m256d acc0 = _mm256_setzero_pd();
+   __m256d acc1 = acc0;
+   size_t index = 0;
+   for(; index + 8 <= count; index += 8)
+   {
+      __m256d delta0 = _mm256_sub_pd(_mm256_loadu_pd(values + index), center);
+      __m256d delta1 = _mm256_sub_pd(_mm256_loadu_pd(values + index + 4), center);
+      acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(delta0, delta0));
+      acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(delta1, delta1));
+   }
+   double result = horizontalSum(foldSum(_mm256_add_pd(acc0, acc1)));
+   for(; index < count; index++)
+   {
+      double delta = values[index] - mean;
+      result += delta * delta;
+   }
+   return result;
+}
+
+AVX2 double trueRangeAVX2(const double* highs, const double* lows, const double* closes, size_t count)
+{
+   if(count < 2) return 0.0;
+
+   const __m256d signMask = _mm256_set1_pd(-0.0);
+   __m256d acc = _mm256_setzero_pd();
+   size_t index = 1;
+   for(; index + 4 <= count; index += 4)
+   {
+      __m256d high = _mm256_loadu_pd(highs + index);
+      __m256d low = _mm256_loadu_pd(lows + index);
+      __m256d previous = _mm256_loadu_pd(closes + index - 1);
+      __m256d range = _mm256_sub_pd(high, low);
+      __m256d up = _mm256_andnot_pd(signMask, _mm256_sub_pd(high, previous));
+      __m256d down = _mm256_andnot_pd(signMask, _mm256_sub_pd(low, previous));
+      acc = _mm256_add_pd(acc, _mm256_max_pd(range, _mm256_max_pd(up, down)));
+   }
+   double result = horizontalSum(foldSum(acc));
+   return result + trueRangeScalar(highs + index - 1, lows + index - 1, closes + index - 1, count - index + 1);
+}
+
+#undef AVX2
+
+const KernelTable kAVX2Table =
+{
+   kernels::Isa::kAVX2,
+   minimumDoubleAVX2,
+   maximumDoubleAVX2,
+   minimumIntAVX2,
+   maximumIntAVX2,
+   sumAVX2,
+   squaredDeviationAVX2,
+   trueRangeAVX2
+};
+
+#endif
+
+//! The active kernels, selected on first use.
+std::atomic<const KernelTable*> sActiveTable{nullptr};
+
+const KernelTable& table()
+{
+   const KernelTable* active = sActiveTable.load(std::memory_order_acquire);
+   if(active == nullptr)
+   {
+      kernels::selectIsa(kernels::supportedIsa());
+      active = sActiveTable.load(std::memory_order_acquire);
+   }
+   return *active;
+}
+
+}
+
+namespace kernels
+{
+
+Isa activeIsa()
+{
+   return table().isa;
+}
+
+Isa supportedIsa()
+{
+   #ifdef KERNELS_X86_64
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx2")) return Isa::kAVX2;
+   return Isa::kSSE2;
+   #else
+   return Isa::kScalar;
+   #endif
+}
+
+Isa selectIsa(Isa isa)
+{
+   isa = std::min(isa, supportedIsa());
+
+   const KernelTable* selected = &kScalarTable;
+   #ifdef KERNELS_X86_64
+   if(isa == Isa::kSSE2) selected = &kSSE2Table;
+   else if(isa == Isa::kAVX2) selected = &kAVX2Table;
+   #endif
+
+   sActiveTable.store(selected, std::memory_order_release);
+   return selected->isa;
+}
+
+const char* isaName(Isa isa)
+{
+   switch(isa)
+   {
+      case Isa::kScalar: return "scalar";
+      case Isa::kSSE2: return "sse2";
+      case Isa::kAVX2: return "avx2";
+   }
+   return "unknown";
+}
+
+double minimum(const double* values, size_t count)
+{
+   return table().minimumDouble(values, count);
+}
+
+double maximum(const double* values, size_t count)
+{
+   return table().maximumDouble(values, count);
+}
+
+int64 minimum(const int64* values, size_t count)
+{
+   return table().minimumInt(values, count);
+}
+
+int64 maximum(const int64* values, size_t count)
+{
+   return table().maximumInt(values, count);
+}
+
+double sum(const double* values, size_t count)
+{
+   return table().sum(values, count);
+}
+
+double mean(const double* values, size_t count)
+{
+   return table().sum(values, count) / count;
+}
+
+double variance(const double* values, size_t count)
+{
+   const KernelTable& kernels = table();
+   double average = kernels.sum(values, count) / count;
+   return kernels.squaredDeviation(values, count, average) / count;
+}
+
+double meanTrueRange(const double* highs, const double* lows, const double* closes, size_t count)
+{
+   return (highs[0] - lows[0] + table().trueRange(highs, lows, closes, count)) / count;
+}
+
+}
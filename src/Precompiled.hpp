@@ -17,6 +17,11 @@
 #ifndef runtemund_stocks_h
 #define runtemund_stocks_h
 
+// The command line is built without the user interface (Makefile target "cli").
+#ifdef STOCKS_CLI
+#include "StockData.h"
+#else
 #include "Stocks.h"
+#endif
 
 #endif /* Precompiled_h */
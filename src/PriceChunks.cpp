@@ -0,0 +1,530 @@
+//
+//  PriceChunks.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Encoding of price bars into compressed chunks.
+//
+
+#include "Precompiled.hpp"
+
+#include <bit>
+#include <cmath>
+#include <numeric>
+
+#include "PriceChunks.h"
+
+namespace chunks
+{
+   //! Current version of the chunk format, the first byte of each chunk.
+   static const uint8 kFormatVersion = 1;
+
+   /*!
+    \brief Writes values of up to 64 bits, most significant bit first.
+    */
+   class BitWriter
+   {
+      public:
+
+         explicit BitWriter(std::vector<uint8>& output): mOutput(output) {}
+
+         void write(uint64 value, int bits)
+         {
+            if(bits > 32)
+            {
+               write(value >> 32, bits - 32);
+               bits = 32;
+            }
+            mBuffer = (mBuffer << bits) | (value & ((uint64(1) << bits) - 1));
+            mBits += bits;
+            while(mBits >= 8)
+            {
+               mBits -= 8;
+               mOutput.push_back((uint8)(mBuffer >> mBits));
+            }
+         }
+
+         //! Writes the last partial byte, filled with zeros.
+         void flush()
+         {
+            if(mBits > 0) mOutput.push_back((uint8)(mBuffer << (8 - mBits)));
+            mBits = 0;
+         }
+
+      private:
+
+         std::vector<uint8>& mOutput;
+
+         //! The lowest mBits bits are not written yet.
+         uint64 mBuffer = 0;
+         int mBits = 0;
+   };
+
+   /*!
+    \brief Reads values of up to 64 bits, most significant bit first. Bits after the end are read as
+    zeros, overrun() tells whether this happened.
+    */
+   class BitReader
+   {
+      public:
+
+         BitReader(const uint8* data, size_t size): mData(data), mSize(size) {}
+
+         uint64 read(int bits)
+         {
+            if(bits > 56)
+            {
+               uint64 high = read(bits - 32);
+               return (high << 32) | read(32);
+            }
+            uint64 value = (window(mPosition >> 3) << (mPosition & 7)) >> (64 - bits);
+            mPosition += bits;
+            return value;
+         }
+
+         bool overrun() const
+         {
+            return mPosition > mSize * 8;
+         }
+
+      private:
+
+         const uint8* mData;
+         size_t mSize;
+
+         //! Position in bits.
+         size_t mPosition = 0;
+
+         //! Returns the 8 bytes from the byte on in big endian order.
+         uint64 window(size_t byte) const
+         {
+            uint64 value = 0;
+            if(byte + 8 <= mSize)
+            {
+               for(size_t index = 0; index < 8; index++) value = (value << 8) | mData[byte + index];
+            }
+            else
+            {
+               for(size_t index = byte; index < byte + 8; index++)
+               {
+                  value = (value << 8) | (index < mSize ? mData[index] : 0);
+               }
+            }
+            return value;
+         }
+   };
+
+   static uint64 zigzag(int64 value)
+   {
+      return ((uint64)value << 1) ^ (uint64)(value >> 63);
+   }
+
+   static int64 unzigzag(uint64 value)
+   {
+      return (int64)(value >> 1) ^ -(int64)(value & 1);
+   }
+
+   static void writeVarint(std::vector<uint8>& output, uint64 value)
+   {
+      while(value >= 0x80)
+      {
+         output.push_back((uint8)(value | 0x80));
+         value >>= 7;
+      }
+      output.push_back((uint8)value);
+   }
+
+   static bool readVarint(const uint8*& data, const uint8* end, uint64& value)
+   {
+      value = 0;
+      for(int shift = 0; shift < 64 && data < end; shift += 7)
+      {
+         uint8 byte = *data++;
+         value |= (uint64)(byte & 0x7f) << shift;
+         if(byte < 0x80) return true;
+      }
+      return false;
+   }
+
+   /*!
+    \brief Returns the time of the bar, the day number for daily bars.
+    */
+   static int64 chunkTime(const PriceHistory& history, size_t index)
+   {
+      return history.intraday() ? history.times()[index] : history.days()[index];
+   }
+
+   /*!
+    \brief Writes the value with the buckets of the Gorilla encoding, small values take fewer bits.
+    */
+   static void writeBucketed(BitWriter& bits, int64 value)
+   {
+      if(value == 0) bits.write(0, 1);
+      else if(value >= -63 && value <= 64)
+      {
+         bits.write(0b10, 2);
+         bits.write(value + 63, 7);
+      }
+      else if(value >= -255 && value <= 256)
+      {
+         bits.write(0b110, 3);
+         bits.write(value + 255, 9);
+      }
+      else if(value >= -2047 && value <= 2048)
+      {
+         bits.write(0b1110, 4);
+         bits.write(value + 2047, 12);
+      }
+      else
+      {
+         bits.write(0b1111, 4);
+         bits.write((uint64)value, 64);
+      }
+   }
+
+   static int64 readBucketed(BitReader& bits)
+   {
+      if(bits.read(1) == 0) return 0;
+      if(bits.read(1) == 0) return (int64)bits.read(7) - 63;
+      if(bits.read(1) == 0) return (int64)bits.read(9) - 255;
+      if(bits.read(1) == 0) return (int64)bits.read(12) - 2047;
+      return (int64)bits.read(64);
+   }
+
+   /*!
+    \brief Writes the values XORed with their predecessor. Only the bits between the leading and
+    trailing zeros of the XOR are written, the window of the previous value is reused if it fits.
+    */
+   static void writeXor(BitWriter& bits, const double* values, size_t count)
+   {
+      uint64 previous = std::bit_cast<uint64>(values[0]);
+      bits.write(previous, 64);
+
+      // No window yet.
+      int leading = -1;
+      int trailing = 0;
+
+      for(size_t index = 1; index < count; index++)
+      {
+         uint64 value = std::bit_cast<uint64>(values[index]);
+         uint64 difference = value ^ previous;
+         previous = value;
+
+         if(difference == 0)
+         {
+            bits.write(0, 1);
+            continue;
+         }
+
+         int lead = std::min(std::countl_zero(difference), 31);
+         int trail = std::countr_zero(difference);
+         if(leading >= 0 && lead >= leading && trail >= trailing)
+         {
+            bits.write(0b10, 2);
+            bits.write(difference >> trailing, 64 - leading - trailing);
+         }
+         else
+         {
+            int meaningful = 64 - lead - trail;
+            bits.write(0b11, 2);
+            bits.write(lead, 5);
+            bits.write(meaningful - 1, 6);
+            bits.write(difference >> trail, meaningful);
+            leading = lead;
+            trailing = trail;
+         }
+      }
+   }
+
+   static bool readXor(BitReader& bits, double* values, size_t count)
+   {
+      uint64 value = bits.read(64);
+      values[0] = std::bit_cast<double>(value);
+
+      int leading = -1;
+      int trailing = 0;
+
+      for(size_t index = 1; index < count; index++)
+      {
+         if(bits.read(1) != 0)
+         {
+            if(bits.read(1) != 0)
+            {
+               leading = (int)bits.read(5);
+               int meaningful = (int)bits.read(6) + 1;
+               trailing = 64 - leading - meaningful;
+               if(trailing < 0) return false;
+            }
+            else if(leading < 0) return false;
+
+            value ^= bits.read(64 - leading - trailing) << trailing;
+         }
+         values[index] = std::bit_cast<double>(value);
+      }
+      return !bits.overrun();
+   }
+
+   //! Powers of ten of the decimal scales.
+   static const double kScales[] = {1.0, 10.0, 100.0, 1000.0, 10000.0};
+
+   //! Scale, which marks a XOR encoded column.
+   static const uint64 kXorScale = 7;
+
+   /*!
+    \brief Returns the number of decimal places, with which all values are exactly restored from
+    integers, or kXorScale if there is none.
+    */
+   static uint64 decimalScale(const double* values, size_t count)
+   {
+      for(uint64 scale = 0; scale < std::size(kScales); scale++)
+      {
+         size_t index = 0;
+         while(index < count)
+         {
+            double scaled = values[index] * kScales[scale];
+
+            // Also false for NaN and infinite values.
+            if(!(std::abs(scaled) < 1e15)) return kXorScale;
+
+            double restored = (double)std::llround(scaled) / kScales[scale];
+            if(std::bit_cast<uint64>(restored) != std::bit_cast<uint64>(values[index])) break;
+            index++;
+         }
+         if(index == count) return scale;
+      }
+      return kXorScale;
+   }
+
+   /*!
+    \brief Writes a price column. Prices with few decimal places, as quoted by exchanges, are
+    written as deltas of integers, other values XOR encoded.
+    */
+   static void writePrices(BitWriter& bits, const double* values, size_t count)
+   {
+      uint64 scale = decimalScale(values, count);
+      bits.write(scale, 3);
+      if(scale == kXorScale)
+      {
+         writeXor(bits, values, count);
+         return;
+      }
+
+      int64 previous = std::llround(values[0] * kScales[scale]);
+      bits.write((uint64)previous, 64);
+      for(size_t index = 1; index < count; index++)
+      {
+         int64 value = std::llround(values[index] * kScales[scale]);
+         writeBucketed(bits, value - previous);
+         previous = value;
+      }
+   }
+
+   static bool readPrices(BitReader& bits, double* values, size_t count)
+   {
+      uint64 scale = bits.read(3);
+      if(scale == kXorScale) return readXor(bits, values, count);
+      if(scale >= std::size(kScales)) return false;
+
+      int64 value = (int64)bits.read(64);
+      values[0] = (double)value / kScales[scale];
+      for(size_t index = 1; index < count; index++)
+      {
+         value += readBucketed(bits);
+         values[index] = (double)value / kScales[scale];
+      }
+      return !bits.overrun();
+   }
+
+   void encode(const PriceHistory& history, size_t first, size_t count, std::vector<uint8>& output)
+   {
+      output.clear();
+      output.push_back(kFormatVersion);
+      writeVarint(output, count);
+      if(count == 0) return;
+
+      int64 previous = chunkTime(history, first);
+      writeVarint(output, zigzag(previous));
+
+      std::vector<uint8> stream;
+      BitWriter bits(stream);
+      if(count > 1)
+      {
+         int64 delta = chunkTime(history, first + 1) - previous;
+         writeVarint(output, zigzag(delta));
+         previous += delta;
+
+         for(size_t index = first + 2; index < first + count; index++)
+         {
+            int64 time = chunkTime(history, index);
+            writeBucketed(bits, time - previous - delta);
+            delta = time - previous;
+            previous = time;
+         }
+      }
+
+      writePrices(bits, history.opens().data() + first, count);
+      writePrices(bits, history.highs().data() + first, count);
+      writePrices(bits, history.lows().data() + first, count);
+      writePrices(bits, history.closes().data() + first, count);
+      bits.flush();
+
+      writeVarint(output, stream.size());
+      output.insert(output.end(), stream.begin(), stream.end());
+
+      const int64* volumes = history.volumes().data() + first;
+      for(size_t index = 0; index < count; index++) writeVarint(output, zigzag(volumes[index]));
+   }
+
+   bool decode(const uint8* data, size_t size, PriceHistory& history)
+   {
+      const uint8* end = data + size;
+      if(size == 0 || *data++ != kFormatVersion) return false;
+
+      uint64 count;
+      if(!readVarint(data, end, count)) return false;
+      if(count == 0) return true;
+
+      // Each bar takes at least one byte for its volume, larger counts are corrupt.
+      if(count > size) return false;
+
+      uint64 value;
+      if(!readVarint(data, end, value)) return false;
+      int64 previous = unzigzag(value);
+      int64 delta = 0;
+      if(count > 1)
+      {
+         if(!readVarint(data, end, value)) return false;
+         delta = unzigzag(value);
+      }
+
+      uint64 streamSize;
+      if(!readVarint(data, end, streamSize) || streamSize > (uint64)(end - data)) return false;
+      BitReader bits(data, streamSize);
+      data += streamSize;
+
+      return history.appendBars(count, [&](const PriceHistory::Bars& bars)
+      {
+         // The times are day numbers for daily bars.
+         auto store = [&](size_t index, int64 time)
+         {
+            if(bars.times == nullptr) bars.days[index] = (int32)time;
+            else
+            {
+               bars.times[index] = time;
+               bars.days[index] = timeToDays(time);
+            }
+         };
+
+         store(0, previous);
+         if(count > 1)
+         {
+            previous += delta;
+            store(1, previous);
+         }
+         for(size_t index = 2; index < count; index++)
+         {
+            delta += readBucketed(bits);
+            previous += delta;
+            store(index, previous);
+         }
+
+         if(!readPrices(bits, bars.opens, count) || !readPrices(bits, bars.highs, count) ||
+            !readPrices(bits, bars.lows, count) || !readPrices(bits, bars.closes, count))
+         {
+            return false;
+         }
+
+         for(size_t index = 0; index < count; index++)
+         {
+            if(!readVarint(data, end, value)) return false;
+            bars.volumes[index] = unzigzag(value);
+         }
+         return data == end;
+      });
+   }
+
+   /*!
+    \brief Returns the indices of the records ordered by time. Of records with the same time, only
+    the last one is kept.
+    */
+   template<typename Time>
+   static std::vector<size_t> chronological(size_t count, Time time)
+   {
+      std::vector<size_t> order(count);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+      {
+         return time(a) < time(b);
+      });
+
+      size_t kept = 0;
+      for(size_t index = 0; index < count; index++)
+      {
+         if(kept > 0 && time(order[kept - 1]) == time(order[index])) order[kept - 1] = order[index];
+         else order[kept++] = order[index];
+      }
+      order.resize(kept);
+      return order;
+   }
+
+   PriceHistory history(std::span<const PriceRecord> records)
+   {
+      std::vector<int32> days(records.size());
+      for(size_t index = 0; index < records.size(); index++)
+      {
+         days[index] = dateToDays(records[index].date);
+      }
+
+      PriceHistory result;
+      std::vector<size_t> order = chronological(records.size(), [&](size_t index)
+      {
+         return days[index];
+      });
+      result.reserve(order.size());
+      for(size_t index : order)
+      {
+         const PriceRecord& record = records[index];
+         result.append(days[index], record.open, record.high, record.low, record.close,
+                       record.volume);
+      }
+      return result;
+   }
+
+   PriceHistory history(BarInterval interval, std::span<const IntradayRecord> records)
+   {
+      PriceHistory result(interval);
+      std::vector<size_t> order = chronological(records.size(), [&](size_t index)
+      {
+         return records[index].time;
+      });
+      result.reserve(order.size());
+      for(size_t index : order) result.append(records[index]);
+      return result;
+   }
+
+   size_t lowerBound(const PriceHistory& history, int64 time, size_t first)
+   {
+      size_t last = history.size();
+      while(first < last)
+      {
+         size_t middle = first + (last - first) / 2;
+         if(history.time(middle) < time) first = middle + 1;
+         else last = middle;
+      }
+      return first;
+   }
+
+   size_t upperBound(const PriceHistory& history, int64 time, size_t first)
+   {
+      size_t last = history.size();
+      while(first < last)
+      {
+         size_t middle = first + (last - first) / 2;
+         if(history.time(middle) <= time) first = middle + 1;
+         else last = middle;
+      }
+      return first;
+   }
+}
@@ -0,0 +1,250 @@
+//
+//  PriceCsvParser.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "PriceCsvParser.h"
+
+//! Longest line, which is buffered across chunks. Longer lines are no price data.
+static const size_t kMaxLineLength = 1024;
+
+//! Powers of ten, which are exactly representable as double.
+static const double kPowersOfTen[] =
+{
+   1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+PriceCsvParser::PriceCsvParser(BatchHandler handler, size_t batchSize):
+   mHandler(std::move(handler)),
+   mBatchSize(std::max(batchSize, size_t(1)))
+{
+   mBatch.reserve(mBatchSize);
+}
+
+size_t PriceCsvParser::rows() const
+{
+   return mRows;
+}
+
+size_t PriceCsvParser::errors() const
+{
+   return mErrors;
+}
+
+bool PriceCsvParser::feed(const char* data, size_t size)
+{
+   const char* end = data + size;
+
+   while(data < end && !mAborted)
+   {
+      const char* lineEnd = (const char*)std::memchr(data, '\n', end - data);
+
+      if(lineEnd == nullptr)
+      {
+         if(mCarry.size() + (end - data) <= kMaxLineLength) mCarry.append(data, end);
+         else mCarry.assign(kMaxLineLength + 1, ' '); // Counted as error when the line ends
+         break;
+      }
+
+      if(mCarry.empty())
+      {
+         parseLine(data, lineEnd);
+      }
+      else
+      {
+         if(mCarry.size() + (lineEnd - data) <= kMaxLineLength) mCarry.append(data, lineEnd);
+         parseLine(mCarry.data(), mCarry.data() + mCarry.size());
+         mCarry.clear();
+      }
+
+      data = lineEnd + 1;
+   }
+
+   return !mAborted;
+}
+
+bool PriceCsvParser::finish()
+{
+   if(!mCarry.empty() && !mAborted)
+   {
+      parseLine(mCarry.data(), mCarry.data() + mCarry.size());
+      mCarry.clear();
+   }
+   return flush();
+}
+
+size_t PriceCsvParser::curlWriteCallback(char* data, size_t size, size_t count, void* parser)
+{
+   size_t bytes = size * count;
+
+   // Returning less than the received bytes makes curl abort the transfer.
+   return ((PriceCsvParser*)parser)->feed(data, bytes) ? bytes : 0;
+}
+
+bool PriceCsvParser::flush()
+{
+   if(mAborted) return false;
+   if(mBatch.empty()) return true;
+
+   if(!mHandler(std::span<const PriceRecord>(mBatch.data(), mBatch.size()))) mAborted = true;
+   mBatch.clear();
+   return !mAborted;
+}
+
+/*!
+ \brief Parses exactly count digits.
+ */
+static bool parseDigits(const char* text, int count, int& value)
+{
+   value = 0;
+   for(int index = 0; index < count; index++)
+   {
+      unsigned digit = (unsigned)(text[index] - '0');
+      if(digit > 9) return false;
+      value = value * 10 + (int)digit;
+   }
+   return true;
+}
+
+/*!
+ \brief Parses a date "yyyy-MM-dd".
+ */
+static bool parseDate(const char* begin, const char* end, jm::Date& date)
+{
+   if(end - begin != 10 || begin[4] != '-' || begin[7] != '-') return false;
+
+   int year, month, day;
+   if(!parseDigits(begin, 4, year) || !parseDigits(begin + 5, 2, month) || !parseDigits(begin + 8, 2, day))
+   {
+      return false;
+   }
+   if(month < 1 || month > 12 || day < 1 || day > 31) return false;
+
+   date = jm::Date(year, month - 1, day);
+   return true;
+}
+
+bool PriceCsvParser::parseDouble(const char* begin, const char* end, double& value)
+{
+   const char* text = begin;
+   bool negative = false;
+   if(text < end && (*text == '-' || *text == '+'))
+   {
+      negative = *text == '-';
+      text++;
+   }
+
+   uint64 mantissa = 0;
+   int significant = 0;
+   int fraction = 0;
+   bool digits = false;
+   bool exact = true;
+
+   for(; text < end && (unsigned)(*text - '0') <= 9; text++)
+   {
+      digits = true;
+      if(mantissa != 0 || *text != '0') significant++;
+      mantissa = mantissa * 10 + (*text - '0');
+      if(significant > 19) exact = false;
+   }
+
+   if(text < end && *text == '.')
+   {
+      text++;
+      for(; text < end && (unsigned)(*text - '0') <= 9; text++)
+      {
+         digits = true;
+         if(mantissa != 0 || *text != '0') significant++;
+         mantissa = mantissa * 10 + (*text - '0');
+         fraction++;
+         if(significant > 19) exact = false;
+      }
+   }
+
+   if(!digits) return false;
+
+   // Both mantissa and power of ten are exact doubles, so the quotient is correctly rounded.
+   if(exact && text == end && mantissa <= (uint64(1) << 53) && fraction <= 22)
+   {
+      value = (double)mantissa / kPowersOfTen[fraction];
+      if(negative) value = -value;
+      return true;
+   }
+
+   // Exponents, long mantissas etc.
+   char buffer[64];
+   size_t length = end - begin;
+   if(length >= sizeof(buffer)) return false;
+   std::memcpy(buffer, begin, length);
+   buffer[length] = 0;
+
+   char* parsed = nullptr;
+   value = std::strtod(buffer, &parsed);
+   return parsed == buffer + length;
+}
+
+void PriceCsvParser::parseLine(const char* begin, const char* end)
+{
+   if(end > begin && end[-1] == '\r') end--;
+   if(end == begin) return;
+
+   bool firstLine = mFirstLine;
+   mFirstLine = false;
+
+   // Split fields in place
+   const char* fields[6];
+   const char* fieldEnds[6];
+   int count = 0;
+   const char* field = begin;
+   while(count < 6)
+   {
+      const char* comma = (const char*)std::memchr(field, ',', end - field);
+      fields[count] = field;
+      fieldEnds[count] = comma ? comma : end;
+      count++;
+      if(comma == nullptr) break;
+      field = comma + 1;
+   }
+
+   PriceRecord record;
+   bool valid = count == 6
+                && parseDate(fields[0], fieldEnds[0], record.date)
+                && parseDouble(fields[1], fieldEnds[1], record.open)
+                && parseDouble(fields[2], fieldEnds[2], record.high)
+                && parseDouble(fields[3], fieldEnds[3], record.low)
+                && parseDouble(fields[4], fieldEnds[4], record.close);
+
+   if(valid)
+   {
+      auto result = std::from_chars(fields[5], fieldEnds[5], record.volume);
+      if(result.ec != std::errc() || result.ptr != fieldEnds[5])
+      {
+         // Some sources write volumes as decimal numbers. NaN fails the range check.
+         double volume;
+         valid = parseDouble(fields[5], fieldEnds[5], volume)
+                 && volume >= -0x1p63 && volume < 0x1p63;
+         if(valid) record.volume = (int64)volume;
+      }
+   }
+
+   if(!valid)
+   {
+      // The header is no error
+      if(!firstLine) mErrors++;
+      return;
+   }
+
+   mBatch.push_back(record);
+   mRows++;
+   if(mBatch.size() >= mBatchSize) flush();
+}
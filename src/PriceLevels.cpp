@@ -0,0 +1,163 @@
+//
+//  PriceLevels.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+/*!
+ \brief Returns the first day after the period of the resolution, which contains the day.
+ */
+static int32 periodEnd(Resolution resolution, int32 day)
+{
+   if(resolution == Resolution::kDay) return day + 1;
+
+   if(resolution == Resolution::kWeek)
+   {
+      // 1970-01-01 was a Thursday, so Monday is day 4 of the first week.
+      int32 shifted = day + 3;
+      int32 week = shifted >= 0 ? shifted / 7 : (shifted - 6) / 7;
+      return (week + 1) * 7 - 3;
+   }
+
+   int32 year, month, date;
+   civilFromDays(day, year, month, date);
+
+   if(resolution == Resolution::kMonth) month++;
+   else if(resolution == Resolution::kQuarter) month = (month - 1) / 3 * 3 + 4;
+   else
+   {
+      year++;
+      month = 1;
+   }
+
+   if(month > 12)
+   {
+      year++;
+      month -= 12;
+   }
+   return daysFromCivil(year, month, 1);
+}
+
+void PriceLevels::update(const PriceHistory& history)
+{
+   if(&history != mHistory || history.baseVersion() != mBaseVersion)
+   {
+      for(Level& level : mLevels) level = Level();
+      mHistory = &history;
+      mBaseVersion = history.baseVersion();
+      mVersion = 0;
+   }
+   if(history.version() == mVersion) return;
+
+   for(Resolution resolution : {Resolution::kDay,
+                                Resolution::kWeek,
+                                Resolution::kMonth,
+                                Resolution::kQuarter,
+                                Resolution::kYear})
+   {
+      if(isHistory(resolution)) continue;
+
+      const std::vector<size_t>& firstBars = level(resolution).firstBars;
+
+      // The last period may have got new bars or its last bar was replaced.
+      if(firstBars.empty()) aggregate(resolution, 0, false);
+      else aggregate(resolution, firstBars.back(), true);
+   }
+
+   mVersion = history.version();
+}
+
+void PriceLevels::aggregate(Resolution resolution, size_t index, bool replace)
+{
+   Level& target = mLevels[(int)resolution - 1];
+
+   const Column<int32>& days = mHistory->days();
+   const Column<double>& opens = mHistory->opens();
+   const Column<double>& highs = mHistory->highs();
+   const Column<double>& lows = mHistory->lows();
+   const Column<double>& closes = mHistory->closes();
+   const Column<int64>& volumes = mHistory->volumes();
+   size_t size = mHistory->size();
+
+   while(index < size)
+   {
+      size_t first = index;
+      int32 end = periodEnd(resolution, days[first]);
+
+      double high = highs[first];
+      double low = lows[first];
+      int64 volume = 0;
+      for(; index < size && days[index] < end; index++)
+      {
+         high = std::max(high, highs[index]);
+         low = std::min(low, lows[index]);
+         volume += volumes[index];
+      }
+
+      if(replace)
+      {
+         target.bars.replaceLast(PriceRecord{daysToDate(days[first]),
+                                             opens[first],
+                                             high,
+                                             low,
+                                             closes[index - 1],
+                                             volume});
+         replace = false;
+      }
+      else
+      {
+         target.bars.append(days[first], opens[first], high, low, closes[index - 1], volume);
+         target.firstBars.push_back(first);
+      }
+   }
+}
+
+const PriceHistory& PriceLevels::bars(Resolution resolution) const
+{
+   if(isHistory(resolution)) return *mHistory;
+   return level(resolution).bars;
+}
+
+size_t PriceLevels::firstBar(Resolution resolution, size_t index) const
+{
+   if(isHistory(resolution)) return index;
+   return level(resolution).firstBars[index];
+}
+
+size_t PriceLevels::barCount(Resolution resolution, size_t index) const
+{
+   if(isHistory(resolution)) return 1;
+
+   const std::vector<size_t>& firstBars = level(resolution).firstBars;
+   size_t end = index + 1 < firstBars.size() ? firstBars[index + 1] : mHistory->size();
+   return end - firstBars[index];
+}
+
+size_t PriceLevels::find(Resolution resolution, size_t bar) const
+{
+   if(isHistory(resolution)) return bar;
+
+   const std::vector<size_t>& firstBars = level(resolution).firstBars;
+   return std::upper_bound(firstBars.begin(), firstBars.end(), bar) - firstBars.begin() - 1;
+}
+
+Resolution PriceLevels::select(double barWidth, double minimumWidth) const
+{
+   if(mHistory == nullptr || mHistory->empty() || barWidth >= minimumWidth) return Resolution::kBar;
+
+   for(Resolution resolution : {Resolution::kDay,
+                                Resolution::kWeek,
+                                Resolution::kMonth,
+                                Resolution::kQuarter})
+   {
+      if(isHistory(resolution)) continue;
+
+      double barsPerPeriod = (double)mHistory->size() / level(resolution).firstBars.size();
+      if(barWidth * barsPerPeriod >= minimumWidth) return resolution;
+   }
+   return Resolution::kYear;
+}
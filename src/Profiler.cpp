@@ -0,0 +1,262 @@
+//
+//  Profiler.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "Profiler.h"
+
+namespace profiler
+{
+#ifdef STOCKS_PROFILE
+
+   /*!
+    \brief A timer measurement or a counter value.
+    */
+   struct Event
+   {
+      const char* name;
+      bool counter;
+      int64 time;
+
+      //! Duration of a timer or value of a counter.
+      int64 value;
+   };
+
+   /*!
+    \brief The events of one thread. The mutex is only contended, while a summary or a trace is
+    read.
+    */
+   struct ThreadBuffer
+   {
+      std::mutex mutex;
+      uint32 thread;
+      std::vector<Event> events;
+      std::vector<Summary> summaries;
+   };
+
+   static const std::chrono::steady_clock::time_point sOrigin = std::chrono::steady_clock::now();
+
+   //! All thread buffers, they outlive their threads, so their events are kept for the trace.
+   static std::mutex sBuffersMutex;
+   static std::vector<std::shared_ptr<ThreadBuffer>> sBuffers;
+
+   static ThreadBuffer& threadBuffer()
+   {
+      thread_local std::shared_ptr<ThreadBuffer> buffer;
+      if(!buffer)
+      {
+         buffer = std::make_shared<ThreadBuffer>();
+         std::lock_guard<std::mutex> lock(sBuffersMutex);
+         buffer->thread = (uint32)sBuffers.size() + 1;
+         sBuffers.push_back(buffer);
+      }
+      return *buffer;
+   }
+
+   static void add(const char* name, bool counter, int64 time, int64 value)
+   {
+      ThreadBuffer& buffer = threadBuffer();
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+
+      if(buffer.events.size() < kMaxEvents) buffer.events.push_back({name, counter, time, value});
+
+      // Few names are used, a linear search by address is faster than any map.
+      Summary* summary = nullptr;
+      for(Summary& entry : buffer.summaries)
+      {
+         if(entry.name == name)
+         {
+            summary = &entry;
+            break;
+         }
+      }
+      if(summary == nullptr)
+      {
+         buffer.summaries.push_back({name, counter, 0, 0, 0, value, time});
+         summary = &buffer.summaries.back();
+      }
+
+      summary->count++;
+      summary->total += value;
+      summary->last = value;
+      summary->maximum = std::max(summary->maximum, value);
+      summary->time = time;
+   }
+
+   int64 now()
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - sOrigin).count();
+   }
+
+   void record(const char* name, int64 start, int64 duration)
+   {
+      add(name, false, start, duration);
+   }
+
+   void count(const char* name, int64 value)
+   {
+      add(name, true, now(), value);
+   }
+
+   bool enabled()
+   {
+      return true;
+   }
+
+   std::vector<Summary> summary()
+   {
+      std::vector<Summary> result;
+
+      std::lock_guard<std::mutex> buffersLock(sBuffersMutex);
+      for(const std::shared_ptr<ThreadBuffer>& buffer : sBuffers)
+      {
+         std::lock_guard<std::mutex> lock(buffer->mutex);
+         for(const Summary& entry : buffer->summaries)
+         {
+            // The same literal may have different addresses in different translation units.
+            auto it = std::find_if(result.begin(), result.end(), [&](const Summary& other)
+            {
+               return std::strcmp(other.name, entry.name) == 0;
+            });
+            if(it == result.end())
+            {
+               result.push_back(entry);
+               continue;
+            }
+
+            it->count += entry.count;
+            it->total += entry.total;
+            it->maximum = std::max(it->maximum, entry.maximum);
+            if(entry.time > it->time)
+            {
+               it->last = entry.last;
+               it->time = entry.time;
+            }
+         }
+      }
+
+      std::sort(result.begin(), result.end(), [](const Summary& a, const Summary& b)
+      {
+         return std::strcmp(a.name, b.name) < 0;
+      });
+      return result;
+   }
+
+   bool summary(const char* name, Summary& result)
+   {
+      for(const Summary& entry : summary())
+      {
+         if(std::strcmp(entry.name, name) == 0)
+         {
+            result = entry;
+            return true;
+         }
+      }
+      return false;
+   }
+
+   void reset()
+   {
+      std::lock_guard<std::mutex> buffersLock(sBuffersMutex);
+      for(const std::shared_ptr<ThreadBuffer>& buffer : sBuffers)
+      {
+         std::lock_guard<std::mutex> lock(buffer->mutex);
+         buffer->events.clear();
+         buffer->summaries.clear();
+      }
+   }
+
+   bool writeTrace(const std::string& file)
+   {
+      std::FILE* output = std::fopen(file.c_str(), "wb");
+      if(output == nullptr)
+      {
+         std::cerr << "Cannot write the trace " << file << std::endl;
+         return false;
+      }
+
+      // Timers are complete events ("X"), counters are counter events ("C"). Times are in µs.
+      std::fprintf(output, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+      bool first = true;
+
+      std::lock_guard<std::mutex> buffersLock(sBuffersMutex);
+      for(const std::shared_ptr<ThreadBuffer>& buffer : sBuffers)
+      {
+         std::lock_guard<std::mutex> lock(buffer->mutex);
+         for(const Event& event : buffer->events)
+         {
+            std::fprintf(output, first ? "\n" : ",\n");
+            first = false;
+
+            if(event.counter)
+            {
+               std::fprintf(output,
+                            "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                            "\"args\":{\"value\":%lld}}",
+                            event.name,
+                            event.time / 1000.0,
+                            buffer->thread,
+                            (long long)event.value);
+            }
+            else
+            {
+               std::fprintf(output,
+                            "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+                            "\"tid\":%u}",
+                            event.name,
+                            event.time / 1000.0,
+                            event.value / 1000.0,
+                            buffer->thread);
+            }
+         }
+      }
+
+      std::fprintf(output, "\n]}\n");
+      bool success = std::ferror(output) == 0;
+      if(std::fclose(output) != 0) success = false;
+      if(!success) std::cerr << "Cannot write the trace " << file << std::endl;
+      return success;
+   }
+
+#else
+
+   bool enabled()
+   {
+      return false;
+   }
+
+   std::vector<Summary> summary()
+   {
+      return std::vector<Summary>();
+   }
+
+   bool summary(const char*, Summary&)
+   {
+      return false;
+   }
+
+   void reset()
+   {
+   }
+
+   bool writeTrace(const std::string&)
+   {
+      std::cerr << "The instrumentation is not compiled in (make PROFILE=1)" << std::endl;
+      return false;
+   }
+
+#endif
+}
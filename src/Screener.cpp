@@ -0,0 +1,153 @@
+//
+//  Screener.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include "Kernels.h"
+#include "Screener.h"
+
+/*!
+ \brief A match found by a worker.
+ */
+struct ScreenerHit
+{
+   //! Index of the symbol, the symbols are ordered alphabetically.
+   size_t symbol;
+   double score;
+   double close;
+   int32 day;
+};
+
+Screener::Screener(const jm::String& dbFile,
+                   const DatabaseOptions& dbOptions,
+                   const ScreenerOptions& options):
+   mOptions(options),
+   mPool(options.threads)
+{
+   for(size_t worker = 0; worker < mPool.size(); worker++)
+   {
+      mConnections.push_back(std::make_unique<StockDatabase>(dbFile, dbOptions));
+   }
+}
+
+Screener::~Screener()
+{
+}
+
+void Screener::addCondition(Condition condition)
+{
+   mConditions.push_back(std::move(condition));
+}
+
+void Screener::clearConditions()
+{
+   mConditions.clear();
+}
+
+void Screener::setScore(Score score)
+{
+   mScore = std::move(score);
+}
+
+size_t Screener::workers() const
+{
+   return mPool.size();
+}
+
+std::vector<ScreenerResult> Screener::run()
+{
+   std::vector<jm::String> symbols = mConnections[0]->symbols();
+
+   std::vector<std::vector<ScreenerHit>> hits(mPool.size());
+
+   mPool.parallelFor(symbols.size(), [&](size_t index, size_t worker)
+   {
+      std::unique_ptr<Stock> stock(mConnections[worker]->stock(symbols[index], mOptions.bars));
+      if(!stock || stock->priceHistory.empty()) return;
+
+      for(const Condition& condition : mConditions)
+      {
+         if(!condition(*stock)) return;
+      }
+
+      const PriceHistory& history = stock->priceHistory;
+      hits[worker].push_back({index,
+                              mScore ? mScore(*stock) : 0.0,
+                              history.closes().back(),
+                              history.days().back()});
+   });
+
+   std::vector<ScreenerHit> ranking;
+   for(const std::vector<ScreenerHit>& workerHits : hits)
+   {
+      ranking.insert(ranking.end(), workerHits.begin(), workerHits.end());
+   }
+
+   std::sort(ranking.begin(), ranking.end(), [](const ScreenerHit& a, const ScreenerHit& b)
+   {
+      if(a.score != b.score) return a.score > b.score;
+      return a.symbol < b.symbol;
+   });
+
+   if(mOptions.limit > 0 && ranking.size() > mOptions.limit) ranking.resize(mOptions.limit);
+
+   std::vector<ScreenerResult> results;
+   results.reserve(ranking.size());
+   for(const ScreenerHit& hit : ranking)
+   {
+      results.push_back({symbols[hit.symbol], hit.score, hit.close, daysToDate(hit.day)});
+   }
+   return results;
+}
+
+double Screener::sma(const PriceHistory& history, int period)
+{
+   if(period <= 0 || history.size() < (size_t)period) return indicators::kNoValue;
+   return kernels::mean(history.closes().end() - period, period);
+}
+
+double Screener::rsi(const PriceHistory& history, int period)
+{
+   indicators::Rsi rsi(period);
+   double value = indicators::kNoValue;
+   for(double close : history.closes()) value = rsi.update(close);
+   return value;
+}
+
+Screener::Condition Screener::closeAboveSma(int period)
+{
+   return [period](const Stock& stock)
+   {
+      // False, if the average is NaN
+      return stock.priceHistory.closes().back() > sma(stock.priceHistory, period);
+   };
+}
+
+Screener::Condition Screener::closeBelowSma(int period)
+{
+   return [period](const Stock& stock)
+   {
+      return stock.priceHistory.closes().back() < sma(stock.priceHistory, period);
+   };
+}
+
+Screener::Condition Screener::rsiBelow(double level, int period)
+{
+   return [level, period](const Stock& stock)
+   {
+      return rsi(stock.priceHistory, period) < level;
+   };
+}
+
+Screener::Condition Screener::rsiAbove(double level, int period)
+{
+   return [level, period](const Stock& stock)
+   {
+      return rsi(stock.priceHistory, period) > level;
+   };
+}
@@ -0,0 +1,285 @@
+//
+//  Snapshot.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+//  Memory mapped price snapshots of the StockDatabase.
+//
+//  A snapshot file holds the complete price history of one stock in native byte order:
+//
+//    SnapshotHeader   64 bytes
+//    int32  day[count]       (days since 1970-01-01)
+//    double open[count]
+//    double high[count]
+//    double low[count]
+//    double close[count]
+//    int64  volume[count]
+//
+//  Every column starts at a multiple of 64 bytes, the gaps are filled with zeros. The checksum
+//  covers everything after the header, the header checksum covers the header fields before it.
+//
+
+#include "Precompiled.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//! Current version of the snapshot format.
+static const uint32 kSnapshotVersion = 1;
+
+//! Written in native byte order to detect files of another architecture.
+static const uint32 kByteOrderMark = 0x01020304;
+
+//! Alignment of the columns in the file.
+static const size_t kColumnAlignment = 64;
+
+struct SnapshotHeader
+{
+   char magic[8];
+   uint32 version;
+   uint32 byteOrder;
+   int64 revision;
+   uint64 count;
+   uint64 checksum;
+   uint64 headerChecksum;
+   uint8 reserved[16];
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "Snapshot header must have 64 bytes");
+
+static const char kSnapshotMagic[8] = {'S', 'T', 'K', 'S', 'N', 'A', 'P', 0};
+
+/*!
+ \brief Byte offsets of the columns and size of a snapshot file with count bars.
+ */
+struct SnapshotLayout
+{
+   size_t days;
+   size_t opens;
+   size_t highs;
+   size_t lows;
+   size_t closes;
+   size_t volumes;
+   size_t fileSize;
+
+   explicit SnapshotLayout(size_t count)
+   {
+      size_t offset = sizeof(SnapshotHeader);
+      days = next(offset, count * sizeof(int32));
+      opens = next(offset, count * sizeof(double));
+      highs = next(offset, count * sizeof(double));
+      lows = next(offset, count * sizeof(double));
+      closes = next(offset, count * sizeof(double));
+      volumes = next(offset, count * sizeof(int64));
+      fileSize = offset;
+   }
+
+   private:
+
+      static size_t next(size_t& offset, size_t bytes)
+      {
+         size_t start = offset;
+         offset = (offset + bytes + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+         return start;
+      }
+};
+
+/*!
+ \brief Returns a 64 bit checksum of the data. Processes 8 bytes per step.
+ */
+static uint64 snapshotChecksum(const uint8* data, size_t size)
+{
+   const uint64 prime1 = 0x9E3779B185EBCA87ull;
+   const uint64 prime2 = 0xC2B2AE3D27D4EB4Full;
+
+   uint64 hash = prime1 ^ size;
+   size_t index = 0;
+   for(; index + 8 <= size; index += 8)
+   {
+      uint64 word;
+      std::memcpy(&word, data + index, 8);
+      hash ^= word * prime2;
+      hash = ((hash << 31) | (hash >> 33)) * prime1;
+   }
+   for(; index < size; index++)
+   {
+      hash ^= data[index] * prime1;
+      hash = ((hash << 11) | (hash >> 53)) * prime2;
+   }
+
+   hash ^= hash >> 33;
+   hash *= prime2;
+   hash ^= hash >> 29;
+   return hash;
+}
+
+static uint64 headerChecksum(const SnapshotHeader& header)
+{
+   return snapshotChecksum((const uint8*)&header, offsetof(SnapshotHeader, headerChecksum));
+}
+
+/*!
+ \brief Returns true, if the header belongs to a snapshot of this format and architecture.
+ */
+static bool validHeader(const SnapshotHeader& header)
+{
+   return std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0
+          && header.version == kSnapshotVersion
+          && header.byteOrder == kByteOrderMark
+          && header.headerChecksum == headerChecksum(header);
+}
+
+std::string StockDatabase::snapshotPath(int stockId) const
+{
+   return mSnapshotDirectory + "/" + std::to_string(stockId) + ".snap";
+}
+
+int64 StockDatabase::snapshotRevision(int stockId) const
+{
+   int file = open(snapshotPath(stockId).c_str(), O_RDONLY);
+   if(file < 0) return -1;
+
+   SnapshotHeader header;
+   bool valid = pread(file, &header, sizeof(header), 0) == sizeof(header) && validHeader(header);
+   close(file);
+
+   return valid ? header.revision : -1;
+}
+
+bool StockDatabase::loadSnapshot(int stockId, int64 revision, PriceHistory& history)
+{
+   std::string path = snapshotPath(stockId);
+
+   int file = open(path.c_str(), O_RDONLY);
+   if(file < 0) return false;
+
+   struct stat info;
+   if(fstat(file, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader))
+   {
+      close(file);
+      return false;
+   }
+
+   size_t size = info.st_size;
+   void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+   close(file);
+   if(memory == MAP_FAILED) return false;
+
+   // Unmapped, when the last column referring to it is gone.
+   std::shared_ptr<const void> storage(memory, [size](const void* data)
+   {
+      munmap(const_cast<void*>(data), size);
+   });
+
+   const uint8* bytes = (const uint8*)memory;
+   SnapshotHeader header;
+   std::memcpy(&header, bytes, sizeof(header));
+
+   if(!validHeader(header) || header.revision != revision) return false;
+
+   SnapshotLayout layout(header.count);
+   if(layout.fileSize != size) return false;
+
+   if(mVerifySnapshots
+      && snapshotChecksum(bytes + layout.days, size - layout.days) != header.checksum)
+   {
+      std::cerr << "Snapshot " << path << " is corrupt" << std::endl;
+      return false;
+   }
+
+   history = PriceHistory::fromColumns(storage,
+                                       header.count,
+                                       (const int32*)(bytes + layout.days),
+                                       (const double*)(bytes + layout.opens),
+                                       (const double*)(bytes + layout.highs),
+                                       (const double*)(bytes + layout.lows),
+                                       (const double*)(bytes + layout.closes),
+                                       (const int64*)(bytes + layout.volumes));
+   return true;
+}
+
+bool StockDatabase::writeSnapshot(int stockId, int64 revision, const PriceHistory& history)
+{
+   mkdir(mSnapshotDirectory.c_str(), 0755);
+
+   size_t count = history.size();
+   SnapshotLayout layout(count);
+   std::vector<uint8> buffer(layout.fileSize, 0);
+
+   std::memcpy(buffer.data() + layout.days, history.days().data(), count * sizeof(int32));
+   std::memcpy(buffer.data() + layout.opens, history.opens().data(), count * sizeof(double));
+   std::memcpy(buffer.data() + layout.highs, history.highs().data(), count * sizeof(double));
+   std::memcpy(buffer.data() + layout.lows, history.lows().data(), count * sizeof(double));
+   std::memcpy(buffer.data() + layout.closes, history.closes().data(), count * sizeof(double));
+   std::memcpy(buffer.data() + layout.volumes, history.volumes().data(), count * sizeof(int64));
+
+   SnapshotHeader header = {};
+   std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+   header.version = kSnapshotVersion;
+   header.byteOrder = kByteOrderMark;
+   header.revision = revision;
+   header.count = count;
+   header.checksum = snapshotChecksum(buffer.data() + layout.days, layout.fileSize - layout.days);
+   header.headerChecksum = headerChecksum(header);
+   std::memcpy(buffer.data(), &header, sizeof(header));
+
+   // Written to a temporary file and renamed, so readers never see a partial snapshot. The name is
+   // unique, so connections rebuilding the same snapshot do not write into each other's file.
+   std::string path = snapshotPath(stockId);
+   std::string temporary = path + ".XXXXXX";
+
+   int file = mkstemp(temporary.data());
+   if(file < 0)
+   {
+      std::cerr << "Can't write snapshot " << path << std::endl;
+      return false;
+   }
+   fchmod(file, 0644);
+
+   size_t written = 0;
+   while(written < buffer.size())
+   {
+      ssize_t result = write(file, buffer.data() + written, buffer.size() - written);
+      if(result <= 0) break;
+      written += result;
+   }
+   close(file);
+
+   if(written != buffer.size() || rename(temporary.c_str(), path.c_str()) != 0)
+   {
+      std::cerr << "Can't write snapshot " << path << std::endl;
+      unlink(temporary.c_str());
+      return false;
+   }
+   return true;
+}
+
+size_t StockDatabase::updateSnapshots()
+{
+   if(mSnapshotDirectory.empty()) return 0;
+
+   std::vector<std::pair<int, int64>> stocks;
+   {
+      ScopedStatement stmt = statement("SELECT id, revision FROM stocks;");
+      if(!stmt) return 0;
+      while(sqlite3_step(stmt) == SQLITE_ROW)
+      {
+         stocks.emplace_back(sqlite3_column_int(stmt, 0), sqlite3_column_int64(stmt, 1));
+      }
+   }
+
+   size_t rebuilt = 0;
+   for(const auto& [stockId, revision] : stocks)
+   {
+      if(snapshotRevision(stockId) == revision) continue;
+      if(writeSnapshot(stockId, revision, getPrices(stockId))) rebuilt++;
+   }
+   return rebuilt;
+}
@@ -0,0 +1,168 @@
+//
+//  StockCache.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include "StockCache.h"
+
+StockCache::StockCache(size_t budget): mBudget(budget)
+{
+}
+
+std::shared_ptr<const Stock> StockCache::get(const jm::String& symbol, const Loader& load)
+{
+   std::string key = symbol.toCString().constData();
+
+   std::unique_lock<std::mutex> lock(mMutex);
+   Entry& entry = mEntries[key];
+
+   if(entry.stock)
+   {
+      mRecent.splice(mRecent.begin(), mRecent, entry.recent);
+      mStatistics.hits++;
+      return entry.stock;
+   }
+
+   // Evicted, but still used somewhere.
+   if(std::shared_ptr<const Stock> used = entry.used.lock())
+   {
+      mStatistics.hits++;
+      admit(key, entry, used);
+      return used;
+   }
+
+   if(entry.loading.valid())
+   {
+      std::shared_future<std::shared_ptr<const Stock>> loading = entry.loading;
+      mStatistics.waits++;
+      lock.unlock();
+      return loading.get();
+   }
+
+   std::promise<std::shared_ptr<const Stock>> promise;
+   entry.loading = promise.get_future().share();
+   entry.load = ++mLoads;
+   uint64 ticket = entry.load;
+   mStatistics.loads++;
+   lock.unlock();
+
+   std::shared_ptr<const Stock> stock;
+   try
+   {
+      stock = load();
+   }
+   catch(...)
+   {
+      // The waiting requests get the exception, the next request loads again.
+      lock.lock();
+      auto it = mEntries.find(key);
+      if(it != mEntries.end() && it->second.load == ticket) mEntries.erase(it);
+      lock.unlock();
+
+      promise.set_exception(std::current_exception());
+      throw;
+   }
+
+   lock.lock();
+   // The entry may have been removed or reloaded by an invalidation in the meantime.
+   auto it = mEntries.find(key);
+   if(it != mEntries.end() && it->second.load == ticket)
+   {
+      it->second.loading = std::shared_future<std::shared_ptr<const Stock>>();
+      if(stock) admit(key, it->second, stock);
+      else mEntries.erase(it);
+   }
+   lock.unlock();
+
+   promise.set_value(stock);
+   return stock;
+}
+
+void StockCache::invalidate(const jm::String& symbol)
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+
+   auto it = mEntries.find(symbol.toCString().constData());
+   if(it == mEntries.end()) return;
+
+   if(it->second.stock) evict(it->second);
+
+   // A running load finishes for its waiting requests, but its stock is not cached.
+   mEntries.erase(it);
+}
+
+void StockCache::clear()
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   mEntries.clear();
+   mRecent.clear();
+   mMemoryUsage = 0;
+}
+
+void StockCache::setBudget(size_t budget)
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   mBudget = budget;
+   trim();
+}
+
+size_t StockCache::budget() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mBudget;
+}
+
+size_t StockCache::memoryUsage() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mMemoryUsage;
+}
+
+size_t StockCache::size() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mRecent.size();
+}
+
+StockCache::Statistics StockCache::statistics() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mStatistics;
+}
+
+void StockCache::admit(const std::string& key, Entry& entry, std::shared_ptr<const Stock> stock)
+{
+   entry.bytes = stock->priceHistory.memoryUsage();
+   entry.used = stock;
+   entry.stock = std::move(stock);
+   mRecent.push_front(key);
+   entry.recent = mRecent.begin();
+   mMemoryUsage += entry.bytes;
+   trim();
+}
+
+void StockCache::evict(Entry& entry)
+{
+   mRecent.erase(entry.recent);
+   mMemoryUsage -= entry.bytes;
+   entry.bytes = 0;
+   entry.stock.reset();
+}
+
+void StockCache::trim()
+{
+   while(mMemoryUsage > mBudget && !mRecent.empty())
+   {
+      auto it = mEntries.find(mRecent.back());
+      evict(it->second);
+      mStatistics.evictions++;
+
+      // Nobody uses the stock any more, so nothing is left to hand out again.
+      if(it->second.used.expired() && !it->second.loading.valid()) mEntries.erase(it);
+   }
+}
@@ -8,48 +8,309 @@
 
 #include "Precompiled.hpp"
 
-StockDatabase::StockDatabase(const jm::String& dbFile) 
+#include <cstring>
+
+#include "PriceChunks.h"
+#include "Profiler.h"
+#include "StockCache.h"
+
+StockDatabase::StockDatabase(const jm::String& dbFile, const DatabaseOptions& options) 
 {
+    mStockCache = options.stockCache ? options.stockCache
+                                     : std::make_shared<StockCache>(options.stockCacheBudget);
+
     if (sqlite3_open(dbFile.toCString().constData(), &mDb)) 
     {
         std::cerr << "Can't open DB: " << sqlite3_errmsg(mDb) << std::endl;
+        sqlite3_close(mDb);
         mDb = nullptr;
+        return;
     }
+
+    applyOptions(options);
+
+    mSnapshotDirectory = options.snapshotDirectory.toCString().constData();
+    mVerifySnapshots = options.verifySnapshots;
+    mCompressPrices = options.compressPrices;
 }
 
 StockDatabase::~StockDatabase() 
 {
+    for (auto& entry : mStatements) sqlite3_finalize(entry.second);
     if (mDb) sqlite3_close(mDb);
 }
 
+void StockDatabase::applyOptions(const DatabaseOptions& options)
+{
+    sqlite3_busy_timeout(mDb, options.busyTimeout);
+
+    std::string sql =
+       "PRAGMA journal_mode = " + std::string(options.journalMode.toCString().constData()) + ";"
+       "PRAGMA cache_size = " + std::to_string(options.cacheSize) + ";"
+       "PRAGMA mmap_size = " + std::to_string(options.mmapSize) + ";"
+       "PRAGMA synchronous = " + std::to_string(options.synchronous) + ";";
+
+    char* errMsg = nullptr;
+    if (sqlite3_exec(mDb, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+    }
+}
+
+sqlite3_stmt* StockDatabase::statement(const char* sql)
+{
+    auto it = mStatements.find(sql);
+    if (it != mStatements.end())
+    {
+        sqlite3_reset(it->second);
+        sqlite3_clear_bindings(it->second);
+        return it->second;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(mDb, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(mDb) << std::endl;
+        return nullptr;
+    }
+
+    mStatements[sql] = stmt;
+    return stmt;
+}
+
+//! Current version of the database schema.
+static const int kSchemaVersion = 5;
+
+bool StockDatabase::exec(const char* sql)
+{
+    char* errMsg = nullptr;
+    int rc = sqlite3_exec(mDb, sql, nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) 
+    {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool StockDatabase::beginWrite(bool& ownTransaction)
+{
+    // Within the caller's transaction, a savepoint lets the batch be undone on its own.
+    ownTransaction = sqlite3_get_autocommit(mDb) != 0;
+    const char* begin = ownTransaction ? "BEGIN IMMEDIATE;" : "SAVEPOINT write_batch;";
+    if (sqlite3_exec(mDb, begin, nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(mDb) << std::endl;
+        return false;
+    }
+
+    // Holding the write lock, so no other connection can compress the prices until the commit.
+    chunkStorage();
+    return true;
+}
+
+bool StockDatabase::endWrite(bool ownTransaction, bool success)
+{
+    if (!ownTransaction)
+    {
+        const char* end = success ? "RELEASE write_batch;"
+                                  : "ROLLBACK TO write_batch; RELEASE write_batch;";
+        if (sqlite3_exec(mDb, end, nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            std::cerr << "SQL error: " << sqlite3_errmsg(mDb) << std::endl;
+            return false;
+        }
+        return success;
+    }
+
+    const char* end = success ? "COMMIT;" : "ROLLBACK;";
+    if (sqlite3_exec(mDb, end, nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(mDb) << std::endl;
+        sqlite3_exec(mDb, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    return success;
+}
+
+int StockDatabase::schemaVersion()
+{
+    ScopedStatement stmt = statement("PRAGMA user_version;");
+    if (!stmt || sqlite3_step(stmt) != SQLITE_ROW) return -1;
+    return sqlite3_column_int(stmt, 0);
+}
+
 bool StockDatabase::initSchema() 
 {
+    if (!mDb) return false;
+
+    int version = schemaVersion();
+    if (version < 0) return false;
+
+    if (version > kSchemaVersion)
+    {
+        std::cerr << "Database schema version " << version << " is newer than supported version "
+                  << kSchemaVersion << std::endl;
+        return false;
+    }
+
+    if (version == 0)
+    {
+        // Version 0 is either an empty file or a file created before the schema was versioned.
+        ScopedStatement stmt = statement("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'prices';");
+        if (stmt && sqlite3_step(stmt) == SQLITE_ROW) version = 1;
+    }
+
+    if (version == 1)
+    {
+        if (!migrateToVersion2()) return false;
+        version = 2;
+    }
+
+    if (version == 2)
+    {
+        if (!migrateToVersion3()) return false;
+        version = 3;
+    }
+
     const char* sql =
        " CREATE TABLE IF NOT EXISTS stocks ("
        "     id INTEGER PRIMARY KEY AUTOINCREMENT,"
        "     symbol TEXT NOT NULL UNIQUE,"
        "     name TEXT,"
-       "     currency TEXT"
+       "     currency TEXT,"
+       "     revision INTEGER NOT NULL DEFAULT 0"
        " );"
 
        " CREATE TABLE IF NOT EXISTS prices ("
-       "     id INTEGER PRIMARY KEY AUTOINCREMENT,"
-       "     stock_id INTEGER,"
-       "     date TEXT,"
+       "     stock_id INTEGER NOT NULL,"
+       "     day INTEGER NOT NULL,"
        "     open REAL,"
        "     high REAL,"
        "     low REAL,"
        "     close REAL,"
        "     volume INTEGER,"
+       "     PRIMARY KEY(stock_id, day),"
        "     FOREIGN KEY(stock_id) REFERENCES stocks(id)"
-       " );";
+       " ) WITHOUT ROWID;"
 
-    char* errMsg = nullptr;
-    int rc = sqlite3_exec(mDb, sql, nullptr, nullptr, &errMsg);
-    if (rc != SQLITE_OK) 
+       // Minute histories have millions of rows per stock. Clustered on the key, a page of bars is
+       // one range scan and no separate index is stored.
+       " CREATE TABLE IF NOT EXISTS intraday_prices ("
+       "     stock_id INTEGER NOT NULL,"
+       "     interval INTEGER NOT NULL,"
+       "     time INTEGER NOT NULL,"
+       "     open REAL,"
+       "     high REAL,"
+       "     low REAL,"
+       "     close REAL,"
+       "     volume INTEGER,"
+       "     PRIMARY KEY(stock_id, interval, time),"
+       "     FOREIGN KEY(stock_id) REFERENCES stocks(id)"
+       " ) WITHOUT ROWID;"
+
+       // A chunk holds up to chunks::kChunkSize bars as one BLOB. Large rows are better kept in a
+       // rowid table, where the key index stays small.
+       " CREATE TABLE IF NOT EXISTS price_chunks ("
+       "     stock_id INTEGER NOT NULL,"
+       "     interval INTEGER NOT NULL,"
+       "     first_time INTEGER NOT NULL,"
+       "     last_time INTEGER NOT NULL,"
+       "     bars INTEGER NOT NULL,"
+       "     data BLOB NOT NULL,"
+       "     PRIMARY KEY(stock_id, interval, first_time),"
+       "     FOREIGN KEY(stock_id) REFERENCES stocks(id)"
+       " );"
+
+       " CREATE TABLE IF NOT EXISTS settings ("
+       "     name TEXT PRIMARY KEY,"
+       "     value TEXT"
+       " ) WITHOUT ROWID;"
+
+       " PRAGMA user_version = 5;";
+
+    if (!exec(sql)) return false;
+
+    if (mCompressPrices && !chunkStorage()) return compressPrices();
+    return true;
+}
+
+bool StockDatabase::chunkStorage()
+{
+    // The conversion is one-way.
+    if (mCompressed) return true;
+
+    // Changes with each commit of another connection, only then the setting is read again.
+    ScopedStatement version = statement("PRAGMA data_version;");
+    if (!version || sqlite3_step(version) != SQLITE_ROW) return false;
+    int64 dataVersion = sqlite3_column_int64(version, 0);
+    if (dataVersion == mDataVersion) return false;
+    mDataVersion = dataVersion;
+
+    ScopedStatement stmt = statement("SELECT value FROM settings WHERE name = 'price_storage';");
+    if (!stmt) return false;
+    const unsigned char* storage = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_text(stmt, 0)
+                                                                     : nullptr;
+    mCompressed = storage && strcmp((const char*)storage, "chunks") == 0;
+    return mCompressed;
+}
+
+bool StockDatabase::migrateToVersion2()
+{
+    std::cerr << "Migrating stock database to schema version 2" << std::endl;
+
+    // Rows are copied in insertion order, so later duplicates of a day replace earlier ones.
+    const char* sql =
+       " BEGIN IMMEDIATE;"
+
+       " CREATE TABLE prices_v2 ("
+       "     stock_id INTEGER NOT NULL,"
+       "     day INTEGER NOT NULL,"
+       "     open REAL,"
+       "     high REAL,"
+       "     low REAL,"
+       "     close REAL,"
+       "     volume INTEGER,"
+       "     PRIMARY KEY(stock_id, day),"
+       "     FOREIGN KEY(stock_id) REFERENCES stocks(id)"
+       " ) WITHOUT ROWID;"
+
+       " INSERT OR REPLACE INTO prices_v2 (stock_id, day, open, high, low, close, volume)"
+       "     SELECT stock_id, CAST(julianday(substr(date, 1, 10)) - 2440587.5 AS INTEGER),"
+       "            open, high, low, close, volume"
+       "     FROM prices"
+       "     WHERE stock_id IS NOT NULL AND julianday(substr(date, 1, 10)) IS NOT NULL"
+       "     ORDER BY id;"
+
+       " DROP TABLE prices;"
+       " ALTER TABLE prices_v2 RENAME TO prices;"
+       " PRAGMA user_version = 2;"
+
+       " COMMIT;";
+
+    if (!exec(sql))
     {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
+        exec("ROLLBACK;");
+        return false;
+    }
+
+    // Give the pages of the old table back to the file system.
+    return exec("VACUUM;");
+}
+
+bool StockDatabase::migrateToVersion3()
+{
+    const char* sql =
+       " BEGIN IMMEDIATE;"
+       " ALTER TABLE stocks ADD COLUMN revision INTEGER NOT NULL DEFAULT 0;"
+       " PRAGMA user_version = 3;"
+       " COMMIT;";
+
+    if (!exec(sql))
+    {
+        exec("ROLLBACK;");
         return false;
     }
     return true;
@@ -59,143 +320,759 @@ int StockDatabase::addStock(const jm::String& symbol,
                             const jm::String& name,
                             const jm::String& currency) 
 {
-    const char* sql = "INSERT OR IGNORE INTO stocks (symbol, name, currency) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
+    ScopedStatement stmt = statement("INSERT OR IGNORE INTO stocks (symbol, name, currency) VALUES (?, ?, ?);");
+    if (!stmt) return -1;
 
-    sqlite3_prepare_v2(mDb, sql, -1, &stmt, nullptr);
     sqlite3_bind_text(stmt, 1, symbol.toCString().constData(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 2, name.toCString().constData(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, currency.toCString().constData(), -1, SQLITE_TRANSIENT);
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
 
     return getStockId(symbol);
 }
 
 int StockDatabase::getStockId(const jm::String& symbol) 
 {
-    const char* sql = "SELECT id FROM stocks WHERE symbol = ?;";
-    sqlite3_stmt* stmt;
-    int stockId = -1;
+    std::string key = symbol.toCString().constData();
 
-    sqlite3_prepare_v2(mDb, sql, -1, &stmt, nullptr);
-    sqlite3_bind_text(stmt, 1, symbol.toCString().constData(), -1, SQLITE_TRANSIENT);
+    auto it = mStockIds.find(key);
+    if (it != mStockIds.end()) return it->second;
 
+    ScopedStatement stmt = statement("SELECT id FROM stocks WHERE symbol = ?;");
+    if (!stmt) return -1;
+
+    sqlite3_bind_text(stmt, 1, key.c_str(), (int)key.size(), SQLITE_STATIC);
+
+    int stockId = -1;
     if (sqlite3_step(stmt) == SQLITE_ROW) 
     {
         stockId = sqlite3_column_int(stmt, 0);
+        mStockIds[key] = stockId;
     }
 
-    sqlite3_finalize(stmt);
     return stockId;
 }
 
-bool StockDatabase::getStockData(const jm::String& symbol,
+bool StockDatabase::getStockData(int stockId,
                                  jm::String& name, 
-                                 jm::String& currency) 
+                                 jm::String& currency,
+                                 int64& revision) 
 {
-    const char* sql = "SELECT name,currency FROM stocks WHERE symbol = ?;";
-    sqlite3_stmt* stmt;
-    jm::String stockName;
+    ScopedStatement stmt = statement("SELECT name,currency,revision FROM stocks WHERE id = ?;");
+    if (!stmt) return false;
 
-    sqlite3_prepare_v2(mDb, sql, -1, &stmt, nullptr);
-    sqlite3_bind_text(stmt, 1, symbol.toCString().constData(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, stockId);
 
-    bool status = false;
+    if (sqlite3_step(stmt) != SQLITE_ROW) return false;
 
-    if (sqlite3_step(stmt) == SQLITE_ROW) 
-    {
-        name = jm::String((const char*)sqlite3_column_text(stmt, 0));
-        currency = jm::String((const char*)sqlite3_column_text(stmt, 1));
-        status = true;
-    }
+    const char* text = (const char*)sqlite3_column_text(stmt, 0);
+    name = jm::String(text ? text : "");
+    text = (const char*)sqlite3_column_text(stmt, 1);
+    currency = jm::String(text ? text : "");
+    revision = sqlite3_column_int64(stmt, 2);
+    return true;
+}
+
+int64 StockDatabase::getRevision(int stockId)
+{
+    ScopedStatement stmt = statement("SELECT revision FROM stocks WHERE id = ?;");
+    if (!stmt) return -1;
 
-    sqlite3_finalize(stmt);
-    return status;
+    sqlite3_bind_int(stmt, 1, stockId);
+
+    if (sqlite3_step(stmt) != SQLITE_ROW) return -1;
+    return sqlite3_column_int64(stmt, 0);
 }
 
 bool StockDatabase::insertPrice(const jm::String& symbol, const PriceRecord& r) 
 {
+    PROFILE_SCOPE("db.insertPrice");
+    return insertPrices(symbol, std::span<const PriceRecord>(&r, 1));
+}
+
+bool StockDatabase::insertPrices(const jm::String& symbol, std::span<const PriceRecord> records)
+{
+    if (records.empty()) return true;
+
+    PROFILE_SCOPE("db.insertPrices");
+    PROFILE_COUNT("db.insertedRows", records.size());
+
     int stock_id = getStockId(symbol);
     if (stock_id < 0) return false;
 
-    const char* sql =
-       "INSERT INTO prices (stock_id, date, open, high, low, close, volume)"
-       " VALUES (?, ?, ?, ?, ?, ?, ?);";
-
-   jm::DateFormatter df=jm::DateFormatter("yyyy-MM-dd");
-
-    sqlite3_stmt* stmt;
-    sqlite3_prepare_v2(mDb, sql, -1, &stmt, nullptr);
-    sqlite3_bind_int(stmt, 1, stock_id);
-    sqlite3_bind_text(stmt, 2, df.format(r.date).toCString().constData(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_double(stmt, 3, r.open);
-    sqlite3_bind_double(stmt, 4, r.high);
-    sqlite3_bind_double(stmt, 5, r.low);
-    sqlite3_bind_double(stmt, 6, r.close);
-    sqlite3_bind_int64(stmt, 8, r.volume);
-
-    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
+    bool ownTransaction;
+    if (!beginWrite(ownTransaction)) return false;
+
+    bool success = mCompressed ? writeChunks(stock_id, BarInterval::kDay, chunks::history(records))
+                               : insertPriceRows(stock_id, records);
+
+    // Outdates the snapshot of the stock.
+    if (success)
+    {
+        ScopedStatement update = statement("UPDATE stocks SET revision = revision + 1 WHERE id = ?;");
+        sqlite3_bind_int(update, 1, stock_id);
+        success = update && sqlite3_step(update) == SQLITE_DONE;
+    }
+
+    if (!success) std::cerr << "SQL error: " << sqlite3_errmsg(mDb) << std::endl;
+
+    success = endWrite(ownTransaction, success);
+
+    // Only after the commit, otherwise a connection sharing the cache could load and keep the old
+    // prices in between. Within a transaction of the caller, the caller invalidates after its commit.
+    if (ownTransaction) mStockCache->invalidate(symbol);
     return success;
 }
 
-jm::Date sqlToDate(const jm::String &date)
+bool StockDatabase::insertIntradayPrices(const jm::String& symbol,
+                                         BarInterval interval,
+                                         std::span<const IntradayRecord> records)
 {
-   return jm::Date(date.substring(0,4).toInt(),
-                   date.substring(5,7).toInt()-1,
-                   date.substring(8,10).toInt());
+    if (records.empty()) return true;
+
+    PROFILE_SCOPE("db.insertIntradayPrices");
+    PROFILE_COUNT("db.insertedRows", records.size());
+
+    int stock_id = getStockId(symbol);
+    if (stock_id < 0) return false;
+
+    bool ownTransaction;
+    if (!beginWrite(ownTransaction)) return false;
+
+    bool success = mCompressed ? writeChunks(stock_id, interval, chunks::history(interval, records))
+                               : insertIntradayRows(stock_id, interval, records);
+
+    if (!success) std::cerr << "SQL error: " << sqlite3_errmsg(mDb) << std::endl;
+
+    return endWrite(ownTransaction, success);
 }
 
-std::vector<PriceRecord> StockDatabase::getPrices(const jm::String& symbol) 
+bool StockDatabase::insertPriceRows(int stockId, std::span<const PriceRecord> records)
 {
-    std::vector<PriceRecord> results;
-    int stock_id = getStockId(symbol);
-    if (stock_id < 0) return results;
+    ScopedStatement stmt = statement("INSERT OR REPLACE INTO prices (stock_id, day, open, high, low, close, volume)"
+                                     " VALUES (?, ?, ?, ?, ?, ?, ?);");
+    if (!stmt) return false;
 
-    const char* sql =
-        "SELECT date, open, high, low, close, volume"
-        " FROM prices"
-        " WHERE stock_id = ?"
-        " ORDER BY date;";
+    sqlite3_bind_int(stmt, 1, stockId);
+
+    for (const PriceRecord& r : records)
+    {
+        sqlite3_bind_int(stmt, 2, dateToDays(r.date));
+        sqlite3_bind_double(stmt, 3, r.open);
+        sqlite3_bind_double(stmt, 4, r.high);
+        sqlite3_bind_double(stmt, 5, r.low);
+        sqlite3_bind_double(stmt, 6, r.close);
+        sqlite3_bind_int64(stmt, 7, r.volume);
 
-    sqlite3_stmt* stmt;
-    sqlite3_prepare_v2(mDb, sql, -1, &stmt, nullptr);
-    sqlite3_bind_int(stmt, 1, stock_id);
+        if (sqlite3_step(stmt) != SQLITE_DONE) return false;
+        sqlite3_reset(stmt);
+    }
+    return true;
+}
 
+bool StockDatabase::insertIntradayRows(int stockId,
+                                       BarInterval interval,
+                                       std::span<const IntradayRecord> records)
+{
+    ScopedStatement stmt = statement("INSERT OR REPLACE INTO intraday_prices"
+                                     " (stock_id, interval, time, open, high, low, close, volume)"
+                                     " VALUES (?, ?, ?, ?, ?, ?, ?, ?);");
+    if (!stmt) return false;
+
+    sqlite3_bind_int(stmt, 1, stockId);
+    sqlite3_bind_int(stmt, 2, (int)interval);
+
+    for (const IntradayRecord& r : records)
+    {
+        sqlite3_bind_int64(stmt, 3, r.time);
+        sqlite3_bind_double(stmt, 4, r.open);
+        sqlite3_bind_double(stmt, 5, r.high);
+        sqlite3_bind_double(stmt, 6, r.low);
+        sqlite3_bind_double(stmt, 7, r.close);
+        sqlite3_bind_int64(stmt, 8, r.volume);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) return false;
+        sqlite3_reset(stmt);
+    }
+    return true;
+}
+
+void StockDatabase::readPrices(sqlite3_stmt* stmt, PriceHistory& results)
+{
     while (sqlite3_step(stmt) == SQLITE_ROW) 
     {
-        PriceRecord r;
+        results.append(sqlite3_column_int(stmt, 0),
+                       sqlite3_column_double(stmt, 1),
+                       sqlite3_column_double(stmt, 2),
+                       sqlite3_column_double(stmt, 3),
+                       sqlite3_column_double(stmt, 4),
+                       sqlite3_column_int64(stmt, 5));
+    }
+
+    // The results are empty before, so their size is the number of read rows.
+    PROFILE_COUNT("db.rows", results.size());
+}
+
+void StockDatabase::readIntradayPrices(sqlite3_stmt* stmt, PriceHistory& results)
+{
+    while (sqlite3_step(stmt) == SQLITE_ROW) 
+    {
+        results.appendIntraday(sqlite3_column_int64(stmt, 0),
+                               sqlite3_column_double(stmt, 1),
+                               sqlite3_column_double(stmt, 2),
+                               sqlite3_column_double(stmt, 3),
+                               sqlite3_column_double(stmt, 4),
+                               sqlite3_column_int64(stmt, 5));
+    }
+
+    PROFILE_COUNT("db.rows", results.size());
+}
+
+PriceHistory StockDatabase::getPrices(int stockId) 
+{
+    if (chunkStorage())
+    {
+        return readChunks(stockId,
+                          BarInterval::kDay,
+                          std::numeric_limits<int64>::min(),
+                          std::numeric_limits<int64>::max());
+    }
+
+    PROFILE_SCOPE("db.getPrices");
+    PriceHistory results;
 
-        jm::String date = jm::String((const char*)sqlite3_column_text(stmt, 0));
+    ScopedStatement stmt = statement("SELECT day, open, high, low, close, volume"
+                                     " FROM prices"
+                                     " WHERE stock_id = ?"
+                                     " ORDER BY day;");
+    if (!stmt) return results;
 
-        r.date = sqlToDate(date);
+    sqlite3_bind_int(stmt, 1, stockId);
+    readPrices(stmt, results);
+
+    // If another connection moved the rows into chunks meanwhile, they are read from there.
+    if (chunkStorage()) return getPrices(stockId);
+    return results;
+}
 
-        r.open = sqlite3_column_double(stmt, 1);
-        r.high = sqlite3_column_double(stmt, 2);
-        r.low = sqlite3_column_double(stmt, 3);
-        r.close = sqlite3_column_double(stmt, 4);
-        r.volume = sqlite3_column_int64(stmt, 5);
-        results.push_back(r);
+PriceHistory StockDatabase::getPrices(int stockId, int32 fromDay, int32 toDay)
+{
+    if (chunkStorage())
+    {
+        return readChunks(stockId,
+                          BarInterval::kDay,
+                          fromDay * kSecondsPerDay,
+                          toDay * kSecondsPerDay);
     }
 
-    sqlite3_finalize(stmt);
+    PROFILE_SCOPE("db.getPrices");
+    PriceHistory results;
+
+    ScopedStatement stmt = statement("SELECT day, open, high, low, close, volume"
+                                     " FROM prices"
+                                     " WHERE stock_id = ? AND day BETWEEN ? AND ?"
+                                     " ORDER BY day;");
+    if (!stmt) return results;
 
-    std::cout<<"Prices collected "<<results.size();
+    sqlite3_bind_int(stmt, 1, stockId);
+    sqlite3_bind_int(stmt, 2, fromDay);
+    sqlite3_bind_int(stmt, 3, toDay);
+    readPrices(stmt, results);
+    if (chunkStorage()) return getPrices(stockId, fromDay, toDay);
     return results;
 }
 
-Stock* StockDatabase::stock(const jm::String& symbol)
+PriceHistory StockDatabase::getPricesBefore(int stockId, int32 beforeDay, size_t count)
 {
-   if(getStockId(symbol)<1)return nullptr;
+    if (chunkStorage())
+    {
+        return readChunksBefore(stockId, BarInterval::kDay, beforeDay * kSecondsPerDay, count);
+    }
+
+    PROFILE_SCOPE("db.getPricesBefore");
+    PriceHistory results;
+
+    // The inner query walks the primary key backwards, the outer one restores chronological order.
+    ScopedStatement stmt = statement("SELECT * FROM ("
+                                     "  SELECT day, open, high, low, close, volume"
+                                     "  FROM prices"
+                                     "  WHERE stock_id = ? AND day < ?"
+                                     "  ORDER BY day DESC"
+                                     "  LIMIT ?)"
+                                     " ORDER BY day;");
+    if (!stmt) return results;
+
+    sqlite3_bind_int(stmt, 1, stockId);
+    sqlite3_bind_int(stmt, 2, beforeDay);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)count);
+    results.reserve(count);
+    readPrices(stmt, results);
+    if (chunkStorage()) return getPricesBefore(stockId, beforeDay, count);
+    return results;
+}
+
+PriceHistory StockDatabase::getIntradayPrices(int stockId,
+                                              BarInterval interval,
+                                              int64 from,
+                                              int64 to)
+{
+    if (chunkStorage()) return readChunks(stockId, interval, from, to);
+
+    PROFILE_SCOPE("db.getIntradayPrices");
+    PriceHistory results(interval);
+
+    ScopedStatement stmt = statement("SELECT time, open, high, low, close, volume"
+                                     " FROM intraday_prices"
+                                     " WHERE stock_id = ? AND interval = ? AND time BETWEEN ? AND ?"
+                                     " ORDER BY time;");
+    if (!stmt) return results;
+
+    sqlite3_bind_int(stmt, 1, stockId);
+    sqlite3_bind_int(stmt, 2, (int)interval);
+    sqlite3_bind_int64(stmt, 3, from);
+    sqlite3_bind_int64(stmt, 4, to);
+    readIntradayPrices(stmt, results);
+    if (chunkStorage()) return getIntradayPrices(stockId, interval, from, to);
+    return results;
+}
+
+PriceHistory StockDatabase::getIntradayPricesBefore(int stockId,
+                                                    BarInterval interval,
+                                                    int64 before,
+                                                    size_t count)
+{
+    if (chunkStorage()) return readChunksBefore(stockId, interval, before, count);
+
+    PROFILE_SCOPE("db.getIntradayPricesBefore");
+    PriceHistory results(interval);
+
+    // The inner query walks the primary key backwards, the outer one restores chronological order.
+    ScopedStatement stmt = statement("SELECT * FROM ("
+                                     "  SELECT time, open, high, low, close, volume"
+                                     "  FROM intraday_prices"
+                                     "  WHERE stock_id = ? AND interval = ? AND time < ?"
+                                     "  ORDER BY time DESC"
+                                     "  LIMIT ?)"
+                                     " ORDER BY time;");
+    if (!stmt) return results;
+
+    sqlite3_bind_int(stmt, 1, stockId);
+    sqlite3_bind_int(stmt, 2, (int)interval);
+    sqlite3_bind_int64(stmt, 3, before);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)count);
+    results.reserve(count);
+    readIntradayPrices(stmt, results);
+    if (chunkStorage()) return getIntradayPricesBefore(stockId, interval, before, count);
+    return results;
+}
+
+bool StockDatabase::writeChunks(int stockId, BarInterval interval, const PriceHistory& bars)
+{
+    if (bars.empty()) return true;
+
+    PROFILE_SCOPE("db.writeChunks");
+    int64 from = bars.time(0);
+
+    // All chunks, which end at or after the first new bar.
+    PriceHistory existing(interval);
+    {
+        ScopedStatement stmt = statement("SELECT data FROM price_chunks"
+                                         " WHERE stock_id = ? AND interval = ? AND last_time >= ?"
+                                         " ORDER BY first_time;");
+        if (!stmt) return false;
+
+        sqlite3_bind_int(stmt, 1, stockId);
+        sqlite3_bind_int(stmt, 2, (int)interval);
+        sqlite3_bind_int64(stmt, 3, from);
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const uint8* data = (const uint8*)sqlite3_column_blob(stmt, 0);
+            if (!chunks::decode(data, sqlite3_column_bytes(stmt, 0), existing))
+            {
+                std::cerr << "Price chunk of stock " << stockId << " is corrupt" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // New bars replace existing bars with the same time.
+    PriceHistory merged(interval);
+    merged.reserve(existing.size() + bars.size());
+    size_t index = 0;
+    size_t next = 0;
+    while (next < bars.size())
+    {
+        size_t end = chunks::lowerBound(existing, bars.time(next), index);
+        merged.append(existing, index, end - index);
+        index = end;
+
+        size_t last = index < existing.size() ? chunks::upperBound(bars, existing.time(index), next)
+                                              : bars.size();
+        merged.append(bars, next, last - next);
+        next = last;
+        if (index < existing.size() && bars.time(next - 1) == existing.time(index)) index++;
+    }
+    merged.append(existing, index, existing.size() - index);
+
+    ScopedStatement remove = statement("DELETE FROM price_chunks"
+                                       " WHERE stock_id = ? AND interval = ? AND last_time >= ?;");
+    if (!remove) return false;
+    sqlite3_bind_int(remove, 1, stockId);
+    sqlite3_bind_int(remove, 2, (int)interval);
+    sqlite3_bind_int64(remove, 3, from);
+    if (sqlite3_step(remove) != SQLITE_DONE) return false;
+
+    ScopedStatement insert = statement("INSERT INTO price_chunks"
+                                       " (stock_id, interval, first_time, last_time, bars, data)"
+                                       " VALUES (?, ?, ?, ?, ?, ?);");
+    if (!insert) return false;
+    sqlite3_bind_int(insert, 1, stockId);
+    sqlite3_bind_int(insert, 2, (int)interval);
+
+    std::vector<uint8> data;
+    for (size_t first = 0; first < merged.size(); first += chunks::kChunkSize)
+    {
+        size_t count = std::min(chunks::kChunkSize, merged.size() - first);
+        chunks::encode(merged, first, count, data);
+
+        sqlite3_bind_int64(insert, 3, merged.time(first));
+        sqlite3_bind_int64(insert, 4, merged.time(first + count - 1));
+        sqlite3_bind_int64(insert, 5, (sqlite3_int64)count);
+        sqlite3_bind_blob(insert, 6, data.data(), (int)data.size(), SQLITE_STATIC);
+        if (sqlite3_step(insert) != SQLITE_DONE) return false;
+        sqlite3_reset(insert);
+    }
+    return true;
+}
+
+PriceHistory StockDatabase::readChunks(int stockId, BarInterval interval, int64 from, int64 to)
+{
+    PROFILE_SCOPE("db.readChunks");
+    PriceHistory results(interval);
+
+    ScopedStatement stmt = statement("SELECT first_time, last_time, data FROM price_chunks"
+                                     " WHERE stock_id = ? AND interval = ?"
+                                     " AND last_time >= ? AND first_time <= ?"
+                                     " ORDER BY first_time;");
+    if (!stmt) return results;
+
+    sqlite3_bind_int(stmt, 1, stockId);
+    sqlite3_bind_int(stmt, 2, (int)interval);
+    sqlite3_bind_int64(stmt, 3, from);
+    sqlite3_bind_int64(stmt, 4, to);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const uint8* data = (const uint8*)sqlite3_column_blob(stmt, 2);
+        size_t size = sqlite3_column_bytes(stmt, 2);
+
+        // Chunks within the range are decoded directly into the history, the others are cut.
+        bool valid;
+        if (sqlite3_column_int64(stmt, 0) >= from && sqlite3_column_int64(stmt, 1) <= to)
+        {
+            valid = chunks::decode(data, size, results);
+        }
+        else
+        {
+            PriceHistory chunk(interval);
+            valid = chunks::decode(data, size, chunk);
+            size_t first = chunks::lowerBound(chunk, from);
+            size_t end = chunks::upperBound(chunk, to, first);
+            results.append(chunk, first, end - first);
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Price chunk of stock " << stockId << " is corrupt" << std::endl;
+            return PriceHistory(interval);
+        }
+    }
+
+    PROFILE_COUNT("db.rows", results.size());
+    return results;
+}
+
+PriceHistory StockDatabase::readChunksBefore(int stockId,
+                                            BarInterval interval,
+                                            int64 before,
+                                            size_t count)
+{
+    PROFILE_SCOPE("db.readChunksBefore");
+
+    // Newest chunk first, until enough bars are decoded.
+    std::vector<PriceHistory> parts;
+    size_t total = 0;
+    {
+        ScopedStatement stmt = statement("SELECT data FROM price_chunks"
+                                         " WHERE stock_id = ? AND interval = ? AND first_time < ?"
+                                         " ORDER BY first_time DESC;");
+        if (!stmt) return PriceHistory(interval);
+
+        sqlite3_bind_int(stmt, 1, stockId);
+        sqlite3_bind_int(stmt, 2, (int)interval);
+        sqlite3_bind_int64(stmt, 3, before);
+
+        while (total < count && sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            parts.emplace_back(interval);
+            const uint8* data = (const uint8*)sqlite3_column_blob(stmt, 0);
+            if (!chunks::decode(data, sqlite3_column_bytes(stmt, 0), parts.back()))
+            {
+                std::cerr << "Price chunk of stock " << stockId << " is corrupt" << std::endl;
+                return PriceHistory(interval);
+            }
+            total += chunks::lowerBound(parts.back(), before);
+        }
+    }
+
+    PriceHistory results(interval);
+    results.reserve(std::min(total, count));
+    size_t skip = total > count ? total - count : 0;
+    for (size_t index = parts.size(); index-- > 0;)
+    {
+        const PriceHistory& part = parts[index];
+        size_t end = chunks::lowerBound(part, before);
+        size_t first = std::min(skip, end);
+        skip -= first;
+        results.append(part, first, end - first);
+    }
+
+    PROFILE_COUNT("db.rows", results.size());
+    return results;
+}
+
+bool StockDatabase::compressPrices()
+{
+    if (!mDb) return false;
+    if (mCompressed) return true;
+
+    if (!exec("BEGIN IMMEDIATE;")) return false;
+
+    // Another connection may have compressed them meanwhile.
+    if (chunkStorage()) return exec("COMMIT;");
+
+    std::cerr << "Compressing the prices of the stock database" << std::endl;
+
+    std::vector<int> stockIds;
+    {
+        ScopedStatement stmt = statement("SELECT id FROM stocks;");
+        while (stmt && sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            stockIds.push_back(sqlite3_column_int(stmt, 0));
+        }
+    }
+
+    bool success = true;
+    for (size_t index = 0; success && index < stockIds.size(); index++)
+    {
+        int stockId = stockIds[index];
+        success = writeChunks(stockId, BarInterval::kDay, getPrices(stockId));
+
+        std::vector<BarInterval> intervals;
+        {
+            ScopedStatement stmt = statement("SELECT DISTINCT interval FROM intraday_prices"
+                                             " WHERE stock_id = ?;");
+            if (stmt) sqlite3_bind_int(stmt, 1, stockId);
+            while (stmt && sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                intervals.push_back((BarInterval)sqlite3_column_int(stmt, 0));
+            }
+        }
+        for (BarInterval interval : intervals)
+        {
+            PriceHistory bars = getIntradayPrices(stockId,
+                                                  interval,
+                                                  std::numeric_limits<int64>::min(),
+                                                  std::numeric_limits<int64>::max());
+            success = success && writeChunks(stockId, interval, bars);
+        }
+    }
+
+    success = success && exec(" DELETE FROM prices;"
+                              " DELETE FROM intraday_prices;"
+                              " INSERT OR REPLACE INTO settings (name, value)"
+                              "     VALUES ('price_storage', 'chunks');");
+
+    if (!success || !exec("COMMIT;"))
+    {
+        std::cerr << "Can't compress the prices: " << sqlite3_errmsg(mDb) << std::endl;
+        exec("ROLLBACK;");
+        return false;
+    }
+    mCompressed = true;
+
+    // Give the pages of the rows back to the file system.
+    return exec("VACUUM;");
+}
+
+bool StockDatabase::compressed()
+{
+    return chunkStorage();
+}
+
+PriceHistory StockDatabase::getPrices(const jm::String& symbol,
+                                      const jm::Date& from,
+                                      const jm::Date& to)
+{
+    int stockId = getStockId(symbol);
+    if (stockId < 0) return PriceHistory();
+    return getPrices(stockId, dateToDays(from), dateToDays(to));
+}
+
+PriceHistory StockDatabase::getPricesBefore(const jm::String& symbol,
+                                            const jm::Date& before,
+                                            size_t count)
+{
+    int stockId = getStockId(symbol);
+    if (stockId < 0) return PriceHistory();
+    return getPricesBefore(stockId, dateToDays(before), count);
+}
+
+PriceHistory StockDatabase::getIntradayPrices(const jm::String& symbol,
+                                              BarInterval interval,
+                                              int64 from,
+                                              int64 to)
+{
+    int stockId = getStockId(symbol);
+    if (stockId < 0) return PriceHistory(interval);
+    return getIntradayPrices(stockId, interval, from, to);
+}
+
+PriceHistory StockDatabase::getIntradayPricesBefore(const jm::String& symbol,
+                                                    BarInterval interval,
+                                                    int64 before,
+                                                    size_t count)
+{
+    int stockId = getStockId(symbol);
+    if (stockId < 0) return PriceHistory(interval);
+    return getIntradayPricesBefore(stockId, interval, before, count);
+}
+
+Stock* StockDatabase::stock(const jm::String& symbol, size_t bars)
+{
+   PROFILE_SCOPE("db.stock");
+
+   int stockId = getStockId(symbol);
+   if(stockId<1)return nullptr;
 
    Stock* stock = new Stock();
    stock->symbol=symbol;
 
-   getStockData(symbol,
+   getStockData(stockId,
                 stock->name,
-                stock->currency);
-   stock->priceHistory=getPrices(symbol);
+                stock->currency,
+                stock->revision);
+
+   if(!mSnapshotDirectory.empty())
+   {
+      // A mapped snapshot is cheaper than any page, so the full history is returned.
+      if(!loadSnapshot(stockId, stock->revision, stock->priceHistory))
+      {
+         stock->priceHistory=getPrices(stockId);
+         writeSnapshot(stockId, stock->revision, stock->priceHistory);
+      }
+   }
+   else if(bars==0)
+   {
+      stock->priceHistory=getPrices(stockId);
+   }
+   else
+   {
+      stock->priceHistory=getPricesBefore(stockId, std::numeric_limits<int32>::max(), bars);
+      stock->mSource=this;
+      stock->mHasOlder=stock->priceHistory.size()==bars;
+   }
 
    return stock;
 }
+
+Stock* StockDatabase::stock(const jm::String& symbol, BarInterval interval, size_t bars)
+{
+   if(interval==BarInterval::kDay)return stock(symbol, bars);
+
+   PROFILE_SCOPE("db.stock");
+
+   int stockId = getStockId(symbol);
+   if(stockId<1)return nullptr;
+
+   Stock* stock = new Stock();
+   stock->symbol=symbol;
+
+   getStockData(stockId,
+                stock->name,
+                stock->currency,
+                stock->revision);
+
+   if(bars==0)
+   {
+      stock->priceHistory=getIntradayPrices(stockId,
+                                            interval,
+                                            std::numeric_limits<int64>::min(),
+                                            std::numeric_limits<int64>::max());
+   }
+   else
+   {
+      stock->priceHistory=getIntradayPricesBefore(stockId,
+                                                  interval,
+                                                  std::numeric_limits<int64>::max(),
+                                                  bars);
+      stock->mSource=this;
+      stock->mHasOlder=stock->priceHistory.size()==bars;
+   }
+
+   return stock;
+}
+
+std::shared_ptr<const Stock> StockDatabase::sharedStock(const jm::String& symbol)
+{
+   // The history is complete, so the stock never needs its database.
+   StockCache::Loader load=[&]()
+   {
+      return std::shared_ptr<const Stock>(stock(symbol));
+   };
+   std::shared_ptr<const Stock> shared=mStockCache->get(symbol, load);
+
+   // Other connections do not invalidate the cache, but each change increases the revision.
+   if(shared!=nullptr && shared->revision!=getRevision(getStockId(symbol)))
+   {
+      mStockCache->invalidate(symbol);
+      shared=mStockCache->get(symbol, load);
+   }
+   return shared;
+}
+
+StockCache& StockDatabase::stockCache()
+{
+   return *mStockCache;
+}
+
+std::vector<jm::String> StockDatabase::symbols()
+{
+    std::vector<jm::String> result;
+
+    ScopedStatement stmt = statement("SELECT symbol FROM stocks ORDER BY symbol;");
+    if (!stmt) return result;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const char* text = (const char*)sqlite3_column_text(stmt, 0);
+        result.push_back(jm::String(text ? text : ""));
+    }
+    return result;
+}
+
+size_t Stock::loadOlder(size_t count)
+{
+   if(!hasOlder() || count==0 || priceHistory.empty())return 0;
+
+   PriceHistory older = priceHistory.intraday()
+                        ? mSource->getIntradayPricesBefore(symbol,
+                                                           priceHistory.interval(),
+                                                           priceHistory.time(0),
+                                                           count)
+                        : mSource->getPricesBefore(symbol, priceHistory.date(0), count);
+   mHasOlder = older.size() == count;
+
+   priceHistory.prepend(older);
+   return older.size();
+}
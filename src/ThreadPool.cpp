@@ -0,0 +1,136 @@
+//
+//  ThreadPool.cpp
+//  stocks
+//
+//  Created by Uwe Runtemund on 17.10.2026
+//  Copyright © 2025 Jameo Software. All rights reserved.
+//
+
+#include "Precompiled.hpp"
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads)
+{
+   if(threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+   mRanges = std::make_unique<Range[]>(threads);
+   for(size_t worker = 0; worker < threads; worker++)
+   {
+      mThreads.emplace_back(&ThreadPool::run, this, worker);
+   }
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+   }
+   mStart.notify_all();
+   for(std::thread& thread : mThreads) thread.join();
+}
+
+size_t ThreadPool::size() const
+{
+   return mThreads.size();
+}
+
+void ThreadPool::parallelFor(size_t count, const Task& task)
+{
+   if(count == 0) return;
+
+   size_t workers = size();
+   for(size_t worker = 0; worker < workers; worker++)
+   {
+      Range& range = mRanges[worker];
+      std::lock_guard<std::mutex> lock(range.mutex);
+      range.begin = count * worker / workers;
+      range.end = count * (worker + 1) / workers;
+   }
+
+   std::unique_lock<std::mutex> lock(mMutex);
+   mTask = &task;
+   mBusy = workers;
+   mGeneration++;
+   mStart.notify_all();
+
+   mDone.wait(lock, [this] { return mBusy == 0; });
+   mTask = nullptr;
+}
+
+void ThreadPool::run(size_t worker)
+{
+   uint64 generation = 0;
+
+   while(true)
+   {
+      const Task* task;
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mStart.wait(lock, [&] { return mStop || mGeneration != generation; });
+         if(mStop) return;
+         generation = mGeneration;
+         task = mTask;
+      }
+
+      size_t index;
+      while(next(worker, index)) (*task)(index, worker);
+
+      std::lock_guard<std::mutex> lock(mMutex);
+      if(--mBusy == 0) mDone.notify_all();
+   }
+}
+
+bool ThreadPool::next(size_t worker, size_t& index)
+{
+   {
+      Range& own = mRanges[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if(own.begin < own.end)
+      {
+         index = own.begin++;
+         return true;
+      }
+   }
+
+   // Steal the back half of the largest range. The victim may have taken more indices after its
+   // range was measured, so the range is checked again when it is split.
+   size_t workers = size();
+   while(true)
+   {
+      size_t victim = workers;
+      size_t largest = 0;
+      for(size_t other = 0; other < workers; other++)
+      {
+         if(other == worker) continue;
+         Range& range = mRanges[other];
+         std::lock_guard<std::mutex> lock(range.mutex);
+         if(range.end - range.begin > largest)
+         {
+            largest = range.end - range.begin;
+            victim = other;
+         }
+      }
+      if(victim == workers) return false;
+
+      size_t begin, end;
+      {
+         Range& range = mRanges[victim];
+         std::lock_guard<std::mutex> lock(range.mutex);
+         if(range.begin >= range.end) continue;
+
+         size_t half = (range.end - range.begin + 1) / 2;
+         end = range.end;
+         begin = end - half;
+         range.end = begin;
+      }
+
+      Range& own = mRanges[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.begin = begin + 1;
+      own.end = end;
+      index = begin;
+      return true;
+   }
+}
@@ -8,6 +8,152 @@
 
 #include "Precompiled.hpp"
 
+#include <cstdio>
+#include <cstring>
+
+#include "Kernels.h"
+#include "Profiler.h"
+
+/*!
+ \brief Forwards the calls to the painter of the frame and counts them. While a display list is set,
+ the drawing calls are also recorded into it.
+
+ Without painter, only the recording of the frame remains (see TradingChart::record()). Text is
+ then measured with a fixed size per character.
+ */
+class CountingPainter
+{
+   public:
+
+      explicit CountingPainter(nui::Painter* painter, DisplayList* frame = nullptr):
+         mPainter(painter),
+         mFrame(frame)
+      {}
+
+      size_t calls() const { return mCalls; }
+
+      void record(DisplayList* list) { mRecord = list; }
+
+      void setLineStyle(nui::LineStyle style)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->setLineStyle(style);
+         if(mRecord != nullptr) mRecord->setLineStyle(style);
+         if(mFrame != nullptr) mFrame->setLineStyle(style);
+      }
+
+      void setFillColor(const jm::Color& color)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->setFillColor(color);
+         if(mRecord != nullptr) mRecord->setFillColor(color);
+         if(mFrame != nullptr) mFrame->setFillColor(color);
+      }
+
+      void setStrokeColor(const jm::Color& color)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->setStrokeColor(color);
+         if(mRecord != nullptr) mRecord->setStrokeColor(color);
+         if(mFrame != nullptr) mFrame->setStrokeColor(color);
+      }
+
+      int wordWidth(const jm::String& text)
+      {
+         mCalls++;
+         if(mPainter == nullptr) return 7 * (int)std::strlen(text.toCString().constData());
+         return mPainter->wordWidth(text);
+      }
+
+      int wordHeight()
+      {
+         mCalls++;
+         return mPainter != nullptr ? mPainter->wordHeight() : 14;
+      }
+
+      int wordAscent()
+      {
+         mCalls++;
+         return mPainter != nullptr ? mPainter->wordAscent() : 11;
+      }
+
+      void drawText(const jm::String& text, const jm::Point& point)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->drawText(text, point);
+         if(mRecord != nullptr) mRecord->drawText(text, point);
+         if(mFrame != nullptr) mFrame->drawText(text, point);
+      }
+
+      void moveTo(const jm::Point& point)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->moveTo(point);
+         if(mRecord != nullptr) mRecord->moveTo(point);
+         if(mFrame != nullptr) mFrame->moveTo(point);
+      }
+
+      void lineTo(const jm::Point& point)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->lineTo(point);
+         if(mRecord != nullptr) mRecord->lineTo(point);
+         if(mFrame != nullptr) mFrame->lineTo(point);
+      }
+
+      void line(const jm::Point& from, const jm::Point& to)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->line(from, to);
+         if(mRecord != nullptr) mRecord->line(from.x(), from.y(), to.x(), to.y());
+         if(mFrame != nullptr) mFrame->line(from.x(), from.y(), to.x(), to.y());
+      }
+
+      void line(double x1, double y1, double x2, double y2)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->line(x1, y1, x2, y2);
+         if(mRecord != nullptr) mRecord->line(x1, y1, x2, y2);
+         if(mFrame != nullptr) mFrame->line(x1, y1, x2, y2);
+      }
+
+      void rectangle(const jm::Rect& rect)
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->rectangle(rect);
+         if(mRecord != nullptr) mRecord->rectangle(rect);
+         if(mFrame != nullptr) mFrame->rectangle(rect);
+      }
+
+      void stroke()
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->stroke();
+         if(mRecord != nullptr) mRecord->stroke();
+         if(mFrame != nullptr) mFrame->stroke();
+      }
+
+      void fill()
+      {
+         mCalls++;
+         if(mPainter != nullptr) mPainter->fill();
+         if(mRecord != nullptr) mRecord->fill();
+         if(mFrame != nullptr) mFrame->fill();
+      }
+
+   private:
+
+      nui::Painter* mPainter;
+
+      size_t mCalls = 0;
+
+      //! Recording of the current layer.
+      DisplayList* mRecord = nullptr;
+
+      //! Recording of the whole frame.
+      DisplayList* mFrame;
+};
+
 
 TradingChart::TradingChart()
 {
@@ -22,6 +168,8 @@ TradingChart::TradingChart()
 
    setOnMouseWheel([this](nui::EventState& state)
    {
+      if(mStock==nullptr)return;
+
       double delta = state.dy;
 
       if(delta>0)
@@ -33,7 +181,9 @@ TradingChart::TradingChart()
          mSpan/=1.1;
       }
 
-      if(mSpan>mStock->priceHistory.size())mSpan=mStock->priceHistory.size();
+      ensureLoaded(mSpan);
+
+      if(mSpan>(int64)mStock->priceHistory.size())mSpan=mStock->priceHistory.size();
       if(mSpan<10)mSpan=10;
 
       mFirst=std::max(mLast-mSpan,int64(0));
@@ -42,9 +192,13 @@ TradingChart::TradingChart()
 
    setOnMouseMove([this](nui::EventState& state)
    {
-      if(state.down == true && state.button == nui::MouseButton::kLeft)
+      if(state.down == true && state.button == nui::MouseButton::kLeft && mStock!=nullptr && mXScale>0)
       {
-         
+         // Dragging the "paper" to the right shows older bars.
+         mPanRemainder+=state.position().x()-mCursor.x();
+         int64 bars=(int64)(mPanRemainder/mXScale);
+         mPanRemainder-=bars*mXScale;
+         if(bars!=0)scrollBy(-bars);
       }
       mCursor=state.position();
       update();
@@ -52,31 +206,137 @@ TradingChart::TradingChart()
 
 }
 
-void TradingChart::setStock(const Stock* stock)
+void TradingChart::setStock(Stock* stock)
+{
+   // Not owned, the aliasing pointer has no owner.
+   mPagedStock=stock;
+   show(std::shared_ptr<const Stock>(std::shared_ptr<const Stock>(),stock));
+}
+
+void TradingChart::setStock(std::shared_ptr<const Stock> stock)
 {
-   mStock=stock;
-   if(stock->priceHistory.size()>0)
+   mPagedStock=nullptr;
+   show(std::move(stock));
+}
+
+void TradingChart::show(std::shared_ptr<const Stock> stock)
+{
+   mStock=std::move(stock);
+   if(mStock!=nullptr && mStock->priceHistory.size()>0)
    {
-      mLast=stock->priceHistory.size()-1;
+      mLast=mStock->priceHistory.size()-1;
+      ensureLoaded(mSpan);
       mFirst=std::max(mLast-mSpan,int64(0));
    }
 }
 
+void TradingChart::ensureLoaded(int64 bars)
+{
+   // Keep one page in reserve left of the visible range, so panning rarely waits for the database.
+   while(mLast-bars<kPageSize && mPagedStock!=nullptr && mPagedStock->hasOlder())
+   {
+      int64 loaded=mPagedStock->loadOlder(std::max(kPageSize,bars-mLast+kPageSize));
+      mFirst+=loaded;
+      mLast+=loaded;
+   }
+}
+
+void TradingChart::scrollBy(int64 bars)
+{
+   ensureLoaded(mSpan-bars);
+
+   int64 size=mStock->priceHistory.size();
+   mLast=std::clamp(mLast+bars,std::min(mSpan,size-1),size-1);
+   mFirst=std::max(mLast-mSpan,int64(0));
+}
+
+
+/*!
+ \brief Returns the time of day (UTC) of the time in seconds as "HH:mm".
+ */
+static jm::String timeOfDay(int64 time)
+{
+   int64 seconds=time-(int64)timeToDays(time)*kSecondsPerDay;
+   char text[8];
+   std::snprintf(text,sizeof(text),"%02d:%02d",(int)(seconds/3600),(int)(seconds/60%60));
+   return jm::String(text);
+}
+
+size_t TradingChart::painterCalls() const
+{
+   return mPainterCalls;
+}
+
+void TradingChart::paint(nui::Painter* target)
+{
+   PROFILE_SCOPE("paint");
+   CountingPainter counter(target);
+   paint(&counter,bounds());
+   mPainterCalls=counter.calls();
+   PROFILE_COUNT("paint.calls",mPainterCalls);
+}
+
+void TradingChart::record(DisplayList& list, double width, double height)
+{
+   list.clear();
+   CountingPainter counter(nullptr,&list);
+   paint(&counter,jm::Rect(0,0,width,height));
+   mPainterCalls=counter.calls();
+}
+
+void TradingChart::showBars(int64 count)
+{
+   if(mStock==nullptr)return;
+
+   mSpan=std::max(count-1,int64(1));
+   ensureLoaded(mSpan);
+   if(mSpan>(int64)mStock->priceHistory.size())mSpan=mStock->priceHistory.size();
+   mFirst=std::max(mLast-mSpan,int64(0));
+   update();
+}
+
+void TradingChart::setProfileHud(bool visible)
+{
+   mProfileHud=visible;
+   update();
+}
 
-bool sameDay(const jm::Date& d1, const jm::Date& d2)
+void TradingChart::postStatus(const jm::String& status, bool busy)
 {
-   return d1.year() == d2.year()
-          && d1.month() == d2.month()
-          && d1.date() == d2.date();
+   std::lock_guard<std::mutex> lock(mStatusMutex);
+   mPostedStatus=status;
+   mStatusPosted=true;
+   mStatusBusy=busy;
 }
 
+void TradingChart::setOnStatusDone(std::function<void()> handler)
+{
+   mOnStatusDone=std::move(handler);
+}
 
-void TradingChart::paint(nui::Painter* painter)
+void TradingChart::paint(CountingPainter* painter, jm::Rect bounds)
 {
    painter->setLineStyle(nui::LineStyle::kSolid);
 
-   if(mStock==nullptr) return;
-   if(mStock->priceHistory.size()==0)return;
+   // Other threads post the status without an event. As long as it is busy, the next frame is
+   // requested here on the UI thread, so the status is polled once per frame.
+   jm::String status;
+   bool hasStatus;
+   bool busy;
+   {
+      std::lock_guard<std::mutex> lock(mStatusMutex);
+      status=mPostedStatus;
+      hasStatus=mStatusPosted;
+      busy=mStatusBusy;
+   }
+   if(hasStatus && busy)update();
+   else if(hasStatus && mOnStatusDone)
+   {
+      // May show another stock, which is painted with this frame.
+      std::function<void()> done=std::move(mOnStatusDone);
+      mOnStatusDone=nullptr;
+      done();
+   }
 
    //
    // Layout Settings
@@ -86,16 +346,31 @@ void TradingChart::paint(nui::Painter* painter)
    jm::Color colAxis = jm::Color::fromRgb(130,130,160);
    jm::Color colForeground = jm::Color::fromRgb(180,180,210);
 
+   if(mStock==nullptr || mStock->priceHistory.size()==0)
+   {
+      // Without prices, e.g. before the first import, only the status is shown.
+      if(hasStatus)
+      {
+         painter->setFillColor(colAxis);
+         painter->drawText(status,jm::Point(20,20+painter->wordAscent()));
+      }
+      return;
+   }
+
    jm::Color colBullishCandle = jm::Color::fromRgb(80,220,130);
    jm::Color colBearishCandle = jm::Color::fromRgb(240,100,100);
 
    jm::Color colVolumeChart = jm::Color::fromRgb(100, 150, 220);
 
+   // Layout and the price ranges
+   PROFILE_BEGIN(scan,"paint.scan");
+   double low = mStock->minPrice(mFirst,mLast);
+   double high = mStock->maxPrice(mFirst,mLast);
+
    int margin=20;
-   int marginRight=25+painter->wordWidth(jm::String("%1").arg(mStock->maxPrice(mFirst,mLast),0,2));
+   int marginRight=25+painter->wordWidth(jm::String("%1").arg(high,0,2));
    int marginBottom=25+painter->wordHeight();
 
-   jm::Rect bounds = this->bounds();
    bounds.setY(0);
 
    chartArea=jm::Rect(jm::Point(margin,margin),jm::Size(bounds.width()-margin-marginRight,bounds.height()-margin-marginBottom));
@@ -103,65 +378,32 @@ void TradingChart::paint(nui::Painter* painter)
    //
    // Chart settings
    //
-   // Note: Data can be incomplete, so the x-axis is time based, but the chart may have gaps
+   // The x-axis is bar based, so nights, weekends and holidays between the sessions take no space.
+   // Gaps are marked by the grid, which has a line at the start of each intraday session.
 
    //Number of shown days
    size_t days = mSpan+1;
 
    mXScale=chartArea.width()/days;
 
-   double low = mStock->minPrice(mFirst,mLast);
-   double high = mStock->maxPrice(mFirst,mLast);
+   // If the bars get too narrow, the bars of a coarser level are drawn instead. So the costs depend
+   // on the number of bars on the screen and not on the length of the history.
+   PriceLevels& levels = mStock->priceLevels;
+   levels.update(mStock->priceHistory);
+   Resolution resolution = levels.select(mXScale,kMinimumBarWidth);
+   const PriceHistory& bars = levels.bars(resolution);
+   size_t firstBar = levels.find(resolution,mFirst);
+   size_t lastBar = levels.find(resolution,mLast);
 
-   double volScale = 100.0/(double)mStock->maxVolume(mFirst,mLast);
+   low = bars.minLow(firstBar,lastBar);
+   high = bars.maxHigh(firstBar,lastBar);
 
+   double volScale = 100.0/(double)bars.maxVolume(firstBar,lastBar);
+   PROFILE_END(scan);
 
-   //
-   // Drawing
-   //
-   
-   // Fill background
-   painter->rectangle(bounds);
-   painter->setFillColor(colBackground);
-   painter->fill();
-
-   //
-   // Draw X-Axis
-   //
-
-   // Draw grid (monthly)
-   painter->setFillColor(colAxis);
-   painter->setStrokeColor(colGrid);
-   jm::DateFormatter df=jm::DateFormatter("MMM");
-   int64 tick=0;
-   jm::Date last=mStock->priceHistory[0].date;
-   for(int64 index=mFirst;index<=mLast;index++)
-   {
-      jm::Date current=mStock->priceHistory[index].date;
-      if(current.month()!=last.month())// 1st of month
-      {
-         jm::String label = df.format(current);
-         int width = painter->wordWidth(label);
-         painter->drawText(label,jm::Point(chartArea.left()+tick*mXScale-0.5*width,chartArea.bottom()+5+painter->wordAscent()));
-         painter->line(chartArea.left()+tick*mXScale,chartArea.bottom(),chartArea.left()+tick*mXScale,chartArea.top());
-         painter->stroke();
-      }
-      tick++;
-      last=current;
-   }
-
-   // Draw axis line
-   painter->setStrokeColor(colAxis);
-   painter->line(chartArea.bottomLeft(),chartArea.bottomRight());
-   painter->stroke();
-
-   //
-   // Draw Y-Axis
-   //
-   painter->setFillColor(colAxis);
-   painter->setStrokeColor(colGrid);
+   // Price axis
    double priceStep=1;
-   double range=(mStock->maxPrice(mFirst,mLast)-mStock->minPrice(mFirst,mLast));
+   double range=high-low;
    if(range<5)priceStep=1.0;
    else if(range<10)priceStep=2.0;
    else if(range<25)priceStep=5.0;
@@ -169,129 +411,340 @@ void TradingChart::paint(nui::Painter* painter)
    else if(range<100)priceStep=20.0;
    else priceStep=std::floor(range/5.0);
 
-   double start=mStock->minPrice(mFirst,mLast)-std::fmod(mStock->minPrice(mFirst,mLast),priceStep);
+   double start=low-std::fmod(low,priceStep);
    double current=0;
-   int ticks= std::ceil((mStock->maxPrice(mFirst,mLast)-start)/priceStep);
+   int ticks= std::ceil((high-start)/priceStep);
 
    double yScale = chartArea.height()/(priceStep*ticks);
 
-   for(int64 index=0;index<=ticks;index++)
-   {
-      painter->drawText(jm::String("%1").arg(start+current,0,2),
-                        jm::Point(chartArea.right()+4,chartArea.bottom()-yScale*current));
-      painter->line(chartArea.left(),chartArea.bottom()-yScale*current,
-                    chartArea.right(),chartArea.bottom()-yScale*current);
-      painter->stroke();
-      current+=priceStep;
-   }
-   // Draw grid (price)
-
-   // Draw axis line
-   painter->setStrokeColor(colAxis);
-   painter->line(chartArea.topRight(),chartArea.bottomRight());
-   painter->stroke();
-
-   // Draw title
-   painter->setFillColor(colAxis);
-   painter->drawText(mStock->name,jm::Point(chartArea.left(),chartArea.top()+painter->wordAscent()));
+   // The grid layer depends on the area, the visible range with its span and resolution and the
+   // price range, the series layer also on the bars. Frames, which only moved the cursor, replay both layers.
+   const PriceHistory& history=mStock->priceHistory;
+   LayerState state={mStock.get(),mFirst,mLast,mSpan,resolution,bounds.width(),bounds.height(),
+                     low,high,history.baseVersion(),history.version()};
+   bool gridValid=!mGridLayer.empty() && state.sameGrid(mLayerState);
+   bool seriesValid=gridValid && !mSeriesLayer.empty() && state==mLayerState;
+   mLayerState=state;
 
+   //
+   // Drawing
+   //
 
-   // Draw volume
-   painter->setFillColor(colVolumeChart);
-   tick=0;
-   for(int64 index=mFirst;index<=mLast;index++)
+   PROFILE_BEGIN(grid,"paint.grid");
+   if(gridValid)mGridLayer.replay(painter);
+   else
    {
-      const PriceRecord& record = mStock->priceHistory[index];
+      mGridLayer.clear();
+      painter->record(&mGridLayer);
 
-      jm::Rect rect = jm::Rect(chartArea.left()+tick*mXScale-0.2*mXScale,
-                                    chartArea.bottom()-record.volume*volScale,
-                                    mXScale*0.4,
-                                    record.volume*volScale );
-      painter->rectangle(rect);
+      // Fill background
+      painter->rectangle(bounds);
+      painter->setFillColor(colBackground);
       painter->fill();
-      tick++;
-   }
 
-   // Draw Linechart
-   painter->setStrokeColor(colForeground);
-   tick=0;
-   bool first=true;
-   for(int64 index=mFirst;index<=mLast;index++)
-   {
-      const PriceRecord& record = mStock->priceHistory[index];
+      //
+      // Draw X-Axis
+      //
+
+      // Draw grid (daily for intraday bars, monthly, yearly if zoomed out)
+      painter->setFillColor(colAxis);
+      painter->setStrokeColor(colGrid);
+      Resolution gridResolution = resolution<=Resolution::kWeek ? Resolution::kMonth
+                                                                : Resolution::kYear;
+      if(history.intraday() && resolution==Resolution::kBar)gridResolution=Resolution::kDay;
+      jm::DateFormatter df=jm::DateFormatter(gridResolution==Resolution::kDay ? "dd.MM"
+                                             : gridResolution==Resolution::kMonth ? "MMM"
+                                                                                  : "yyyy");
+      const PriceHistory& gridBars = levels.bars(gridResolution);
+      double labelEnd=-std::numeric_limits<double>::infinity();
+      double lineEnd=labelEnd;
+      size_t gridLast=levels.find(gridResolution,mLast);
+      for(size_t index=levels.find(gridResolution,mFirst);index<=gridLast;index++)
+      {
+         // Line at the first bar of the period, the very first bar starts no period. At most one
+         // line is drawn per pixel column.
+         size_t bar=levels.firstBar(gridResolution,index);
+         if(bar<(size_t)mFirst || bar==0)continue;
+
+         double x=chartArea.left()+(bar-mFirst)*mXScale;
+         if(x<lineEnd)continue;
+         painter->line(x,chartArea.bottom(),x,chartArea.top());
+         lineEnd=x+1.0;
+
+         // Labels, which would overlap the previous one, are skipped.
+         jm::String label = df.format(gridBars.date(index));
+         int width = painter->wordWidth(label);
+         if(x-0.5*width<labelEnd)continue;
+         painter->drawText(label,jm::Point(x-0.5*width,chartArea.bottom()+5+painter->wordAscent()));
+         labelEnd=x+0.5*width+5;
+      }
+      painter->stroke();
+
+      // Draw axis line
+      painter->setStrokeColor(colAxis);
+      painter->line(chartArea.bottomLeft(),chartArea.bottomRight());
+      painter->stroke();
+
+      //
+      // Draw Y-Axis
+      //
+      painter->setFillColor(colAxis);
+      painter->setStrokeColor(colGrid);
+      for(int64 index=0;index<=ticks;index++)
+      {
+         painter->drawText(jm::String("%1").arg(start+current,0,2),
+                           jm::Point(chartArea.right()+4,chartArea.bottom()-yScale*current));
+         painter->line(chartArea.left(),chartArea.bottom()-yScale*current,
+                       chartArea.right(),chartArea.bottom()-yScale*current);
+         current+=priceStep;
+      }
+      painter->stroke();
+      // Draw grid (price)
 
-      if(first)painter->moveTo(jm::Point(chartArea.left()+tick*mXScale,chartArea.bottom()-(mStock->priceHistory[index].close-start)*yScale));
-      else painter->lineTo(jm::Point(chartArea.left()+tick*mXScale,chartArea.bottom()-(mStock->priceHistory[index].close-start)*yScale));
-      first=false;
+      // Draw axis line
+      painter->setStrokeColor(colAxis);
+      painter->line(chartArea.topRight(),chartArea.bottomRight());
+      painter->stroke();
 
-      tick++;
+      // Draw title
+      painter->setFillColor(colAxis);
+      painter->drawText(mStock->name,
+                        jm::Point(chartArea.left(),chartArea.top()+painter->wordAscent()));
+      painter->record(nullptr);
    }
-   painter->stroke();
+   PROFILE_END(grid);
 
-   // Draw candles
-   tick=0;
-   for(int64 index=mFirst;index<=mLast;index++)
+   PROFILE_BEGIN(series,"paint.series");
+   if(seriesValid)mSeriesLayer.replay(painter);
+   else
    {
-      const PriceRecord& record = mStock->priceHistory[index];
+      mSeriesLayer.clear();
+      painter->record(&mSeriesLayer);
 
-      double candleTop=std::max(record.open,record.close);
-      double candleHeight=std::abs(record.open-record.close);
+      PROFILE_BEGIN(aggregate,"paint.aggregate");
 
-      if(record.close > record.open)
+      // Center and width of a bar, a bar of a level spans the bars of the history it aggregates.
+      auto barX = [&](size_t bar)
+      {
+         double center = levels.firstBar(resolution,bar)+0.5*(levels.barCount(resolution,bar)-1);
+         return chartArea.left()+(center-mFirst)*mXScale;
+      };
+      auto barWidth = [&](size_t bar)
+      {
+         return levels.barCount(resolution,bar)*mXScale;
+      };
+
+      const double* opens = bars.opens().data();
+      const double* highs = bars.highs().data();
+      const double* lows = bars.lows().data();
+      const double* closes = bars.closes().data();
+      const int64* volumes = bars.volumes().data();
+
+      // Bars below one pixel are aggregated per pixel column, so at most one candle, volume bar
+      // and four line points are drawn per column, however many bars are visible.
+      mDrawnBars.clear();
+      double spanPerBar = (double)(mLast-mFirst+1)/(lastBar-firstBar+1);
+      if(spanPerBar*mXScale>=kAggregationWidth)
       {
-         painter->setStrokeColor(colBullishCandle);
-         painter->setFillColor(colBullishCandle);
+         for(size_t index=firstBar;index<=lastBar;index++)
+         {
+            double x=barX(index);
+            mDrawnBars.push_back({x,barWidth(index),x,x,
+                                  opens[index],highs[index],lows[index],closes[index],
+                                  closes[index],closes[index],closes[index],volumes[index]});
+         }
       }
       else
       {
-         painter->setStrokeColor(colBearishCandle);
-         painter->setFillColor(colBearishCandle);            
+         size_t begin=firstBar;
+         while(begin<=lastBar)
+         {
+            // The bars of the column are those up to the first bar right of it.
+            double column=std::floor(barX(begin)-chartArea.left());
+            double right=chartArea.left()+column+1.0;
+            size_t end=begin+1;
+            size_t limit=lastBar+1;
+            while(end<limit)
+            {
+               size_t middle=end+(limit-end)/2;
+               if(barX(middle)<right)end=middle+1;
+               else limit=middle;
+            }
+
+            size_t count=end-begin;
+            mDrawnBars.push_back({chartArea.left()+column+0.5,1.0,barX(begin),barX(end-1),
+                                  opens[begin],
+                                  kernels::maximum(highs+begin,count),
+                                  kernels::minimum(lows+begin,count),
+                                  closes[end-1],
+                                  closes[begin],
+                                  kernels::minimum(closes+begin,count),
+                                  kernels::maximum(closes+begin,count),
+                                  kernels::maximum(volumes+begin,count)});
+            begin=end;
+         }
       }
 
-      painter->line(jm::Point(chartArea.left()+tick*mXScale,chartArea.bottom()-(record.low-start)*yScale),
-                     jm::Point(chartArea.left()+tick*mXScale,chartArea.bottom()-(record.high-start)*yScale));
-      painter->stroke();
-      painter->rectangle(jm::Rect(chartArea.left()+tick*mXScale-0.4*mXScale,
-                                    chartArea.bottom()-(candleTop-start)*yScale,
-                                    mXScale*0.8,
-                                    candleHeight*yScale ));
+      PROFILE_END(aggregate);
+
+      // Draw volume
+      PROFILE_BEGIN(volume,"paint.volume");
+      painter->setFillColor(colVolumeChart);
+      for(const DrawnBar& bar : mDrawnBars)
+      {
+         jm::Rect rect = jm::Rect(bar.x-0.2*bar.width,
+                                       chartArea.bottom()-bar.volume*volScale,
+                                       bar.width*0.4,
+                                       bar.volume*volScale );
+         painter->rectangle(rect);
+      }
       painter->fill();
-      tick++;
+
+      PROFILE_END(volume);
+
+      // Draw Linechart
+      PROFILE_BEGIN(line,"paint.line");
+      painter->setStrokeColor(colForeground);
+      bool first=true;
+      for(const DrawnBar& bar : mDrawnBars)
+      {
+         jm::Point point(bar.firstX,chartArea.bottom()-(bar.firstClose-start)*yScale);
+         if(first)painter->moveTo(point);
+         else painter->lineTo(point);
+         first=false;
+
+         if(bar.minClose<bar.maxClose)
+         {
+            painter->lineTo(jm::Point(bar.x,chartArea.bottom()-(bar.minClose-start)*yScale));
+            painter->lineTo(jm::Point(bar.x,chartArea.bottom()-(bar.maxClose-start)*yScale));
+            painter->lineTo(jm::Point(bar.lastX,chartArea.bottom()-(bar.close-start)*yScale));
+         }
+      }
+      painter->stroke();
+
+      PROFILE_END(line);
+
+      // Draw candles, all bullish and all bearish candles are one path each. The wicks are one
+      // pixel wide rectangles, so they are filled together with the bodies.
+      PROFILE_BEGIN(candles,"paint.candles");
+      for(bool bullish : {true,false})
+      {
+         painter->setFillColor(bullish ? colBullishCandle : colBearishCandle);
+         for(const DrawnBar& bar : mDrawnBars)
+         {
+            if((bar.close > bar.open)!=bullish)continue;
+
+            double candleTop=std::max(bar.open,bar.close);
+            double candleHeight=std::abs(bar.open-bar.close);
+
+            painter->rectangle(jm::Rect(bar.x-0.5,
+                                        chartArea.bottom()-(bar.high-start)*yScale,
+                                        1.0,
+                                        (bar.high-bar.low)*yScale));
+            painter->rectangle(jm::Rect(bar.x-0.4*bar.width,
+                                          chartArea.bottom()-(candleTop-start)*yScale,
+                                          bar.width*0.8,
+                                          candleHeight*yScale ));
+         }
+         painter->fill();
+      }
+      PROFILE_END(candles);
+      painter->record(nullptr);
    }
+   PROFILE_END(series);
 
 /*
    // DRAW MACD
    double macdScale = 100/3;
 
-   MACD macdCalculator;
-   std::vector<MACDPoint> macdData = macdCalculator.compute(mStock->priceHistory);
+   // Computed once, repaints reuse the cached series.
+   indicators::MacdSeries macd = mStock->indicatorCache.macd(mStock->priceHistory);
+   size_t warmUp = indicators::Macd().warmUp();
 
    // MACD line
    painter->setStrokeColor(jm::Color::fromRgb(255, 165, 0));
-   painter->moveTo(jm::Point(chartArea.left()+35*xScale,chartArea.center().y()-(macdData[0].macd)*macdScale));
-   for(size_t index=0;index<=mLast-35;index++)
+   painter->moveTo(jm::Point(chartArea.left()+warmUp*xScale,chartArea.center().y()-(macd.macd[warmUp])*macdScale));
+   for(size_t index=warmUp;index<=mLast;index++)
    {
-      painter->lineTo(jm::Point(chartArea.left()+(index+35)*xScale,chartArea.center().y()-(macdData[index].macd)*macdScale));
+      painter->lineTo(jm::Point(chartArea.left()+index*xScale,chartArea.center().y()-(macd.macd[index])*macdScale));
    }
    painter->stroke();
 
    // Signal line
    painter->setStrokeColor(jm::Color::fromRgb(0, 200, 255));
-   painter->moveTo(jm::Point(chartArea.left()+35*xScale,chartArea.center().y()-(macdData[0].signal)*macdScale));
-   for(size_t index=0;index<=mLast-35;index++)
+   painter->moveTo(jm::Point(chartArea.left()+warmUp*xScale,chartArea.center().y()-(macd.signal[warmUp])*macdScale));
+   for(size_t index=warmUp;index<=mLast;index++)
    {
-      painter->lineTo(jm::Point(chartArea.left()+(index+35)*xScale,chartArea.center().y()-(macdData[index].signal)*macdScale));
+      painter->lineTo(jm::Point(chartArea.left()+index*xScale,chartArea.center().y()-(macd.signal[index])*macdScale));
    }
    painter->stroke();
 
    // Histogram
 */
-   // Draw line cross
+   // Draw line cross and the readout of the price and the bar at the cursor
    if(chartArea.contains(mCursor))
    {
+      PROFILE_SCOPE("paint.crosshair");
+      painter->setStrokeColor(colForeground);
       painter->setLineStyle(nui::LineStyle::kDashed);
       painter->line(mCursor.x(),chartArea.top(),mCursor.x(),chartArea.bottom());
       painter->line(chartArea.left(),mCursor.y(),chartArea.right(),mCursor.y());
       painter->stroke();
+
+      int ascent=painter->wordAscent();
+      double price=start+(chartArea.bottom()-mCursor.y())/yScale;
+      painter->setFillColor(colGrid);
+      painter->rectangle(jm::Rect(chartArea.right()+1,mCursor.y()-ascent,marginRight-1,
+                                  painter->wordHeight()));
+      painter->fill();
+      painter->setFillColor(colForeground);
+      painter->drawText(jm::String("%1").arg(price,0,2),jm::Point(chartArea.right()+4,mCursor.y()));
+
+      int64 bar=mFirst+(int64)std::floor((mCursor.x()-chartArea.left())/mXScale+0.5);
+      bar=std::clamp(bar,mFirst,std::min(mLast,(int64)history.size()-1));
+      jm::String date=jm::DateFormatter("dd.MM.yyyy").format(history.date(bar));
+      if(history.intraday())date=jm::String("%1 %2").arg(date).arg(timeOfDay(history.time(bar)));
+      jm::String readout=jm::String("%1  O %2  H %3  L %4  C %5  V %6")
+                            .arg(date)
+                            .arg(history.opens()[bar],0,2)
+                            .arg(history.highs()[bar],0,2)
+                            .arg(history.lows()[bar],0,2)
+                            .arg(history.closes()[bar],0,2)
+                            .arg(history.volumes()[bar]);
+      painter->drawText(readout,jm::Point(chartArea.right()-painter->wordWidth(readout),
+                                          chartArea.top()+ascent));
+   }
+
+   // Painted each frame, so a posted status appears without invalidating the layers.
+   if(hasStatus)
+   {
+      painter->setFillColor(colAxis);
+      painter->drawText(status,jm::Point(chartArea.left(),
+                                         chartArea.top()+painter->wordHeight()+
+                                         painter->wordAscent()));
+   }
+
+#ifdef STOCKS_PROFILE
+   // The HUD shows the latest measurement of each phase, the total of the frame is the one before.
+   if(mProfileHud)
+   {
+      static const char* const kPhases[]={"paint","paint.scan","paint.grid","paint.series",
+                                          "paint.aggregate","paint.volume","paint.line",
+                                          "paint.candles","paint.crosshair","paint.calls"};
+      int lineHeight=painter->wordHeight();
+      double y=chartArea.top()+2*lineHeight;
+      painter->setFillColor(colForeground);
+      for(const char* phase : kPhases)
+      {
+         profiler::Summary summary;
+         if(!profiler::summary(phase,summary))continue;
+
+         jm::String text=summary.counter ? jm::String("%1 %2").arg(phase).arg(summary.last)
+                                         : jm::String("%1 %2 ms").arg(phase)
+                                                                 .arg(summary.last/1e6,0,3);
+         y+=lineHeight;
+         painter->drawText(text,jm::Point(chartArea.left(),y));
+      }
    }
+#endif
 }